@@ -24,23 +24,88 @@ error:
 	return NULL;
 }
 
-static int BSTree_destroy_cb(BSTreeNode *node)
+BSTree *BSTree_create_balanced(BSTree_compare compare)
 {
-	free(node);
-	return 0;
+	BSTree *map = BSTree_create(compare);
+	check(map, "Failed to create map.");
+
+	map->engine = BSTREE_RED_BLACK;
+
+	return map;
+
+error:
+	return NULL;
+}
+
+BSTree *BSTree_create_pooled(BSTree_compare compare, Pool *pool)
+{
+	check(pool, "pool can't be NULL");
+	check(pool->element_size >= sizeof(BSTreeNode), "Pool elements are too small for BSTreeNode.");
+
+	BSTree *map = BSTree_create(compare);
+	check(map, "Failed to create map.");
+
+	map->pool = pool;
+
+	return map;
+
+error:
+	return NULL;
+}
+
+static inline void BSTreeNode_destroy(BSTree *map, BSTreeNode *node)
+{
+	if(node >= map->block && node < map->block + map->block_size) {
+		// freed with the whole block
+		return;
+	} else if(map->pool) {
+		Pool_free(map->pool, node);
+	} else {
+		free(node);
+	}
+}
+
+// no recursion and no stack: leaves are freed and cut off their parents
+static void BSTree_destroy_nodes(BSTree *map, BSTreeNode *node)
+{
+	BSTreeNode *parent = NULL;
+
+	while(node) {
+		if(node->left) {
+			node = node->left;
+		} else if(node->right) {
+			node = node->right;
+		} else {
+			parent = node->parent;
+
+			if(parent) {
+				if(parent->left == node) {
+					parent->left = NULL;
+				} else {
+					parent->right = NULL;
+				}
+			}
+
+			BSTreeNode_destroy(map, node);
+			node = parent;
+		}
+	}
 }
 
 void BSTree_destroy(BSTree *map)
 {
 	if(map) {
-		BSTree_traverse(map, BSTree_destroy_cb);
+		if(map->root) {
+			BSTree_destroy_nodes(map, map->root);
+		}
+		free(map->block);
 		free(map);
 	}
 }
 
-static inline BSTreeNode *BSTreeNode_create(BSTreeNode *parent, void *key, void *data)
+static inline BSTreeNode *BSTreeNode_create(BSTree *map, BSTreeNode *parent, void *key, void *data)
 {
-	BSTreeNode *node = calloc(1, sizeof(BSTreeNode));
+	BSTreeNode *node = map->pool ? Pool_alloc(map->pool) : calloc(1, sizeof(BSTreeNode));
 	check_mem(node);
 
 	node->key = key;
@@ -52,95 +117,88 @@ error:
 	return NULL;
 }
 
-static inline void BSTree_setnode(BSTree *map, BSTreeNode *node, void *key, void *data)
+/*
+ * Links block[low..high] under 'parent', the middle node is the root.
+ * Smaller keys go right, see BSTree_setnode. Nodes deeper than
+ * 'black_depth' are the unfilled last level, they are red.
+ */
+static BSTreeNode *BSTree_build_nodes(BSTree *map, BSTreeNode *parent, int low, int high, int depth, int black_depth)
 {
-	int cmp = map->compare(node->key, key);
-	
-	if(cmp <= 0) {
-		if(node->left) {
-			BSTree_setnode(map, node->left, key, data);
-		} else {
-			node->left = BSTreeNode_create(node, key, data);
-		}
-	} else {
-		if(node->right) {
-			BSTree_setnode(map, node->right, key, data);
-		} else {
-			node->right = BSTreeNode_create(node, key, data);
-		}
-	}
-}
+	if(low > high) return NULL;
 
-int BSTree_set(BSTree *map, void *key, void *data)
-{
-	if(map->root == NULL) {
-		// first so just make it and get out
-		map->root = BSTreeNode_create(NULL, key, data);
-		check_mem(map->root);
-	} else {
-		BSTree_setnode(map, map->root, key, data);
-	}
+	int middle = low + (high - low) / 2;
+	BSTreeNode *node = &map->block[middle];
 
-	return 0;
-error:
-	return -1;
+	node->parent = parent;
+	node->color = depth >= black_depth ? BSTREE_RED : BSTREE_BLACK;
+	node->right = BSTree_build_nodes(map, node, low, middle - 1, depth + 1, black_depth);
+	node->left = BSTree_build_nodes(map, node, middle + 1, high, depth + 1, black_depth);
+
+	return node;
 }
 
-static inline BSTreeNode *BSTree_getnode(BSTree *map, BSTreeNode *node, void *key)
+int BSTree_build_sorted(BSTree *map, void **keys, void **values, int n)
 {
-	int cmp = map->compare(node->key, key);
+	int black_depth = 0;
+	int i = 0;
 
-	if(cmp == 0) {
-		return node;
-	} else if(cmp < 0) {
-		if(node->left) {
-			return BSTree_getnode(map, node->left, key);
-		} else {
-			return NULL;
-		}
-	} else {
-		if(node->right) {
-			return BSTree_getnode(map, node->right, key);
-		} else {
-			return NULL;
-		}
-	}
-}
+	check(map->root == NULL, "The map must be empty.");
+	check(n >= 0, "Invalid number of keys.");
 
-void *BSTree_get(BSTree *map, void *key)
-{
-	if(map->root == NULL) {
-		return NULL;
-	} else {
-		BSTreeNode *node = BSTree_getnode(map, map->root, key);
-		return node == NULL ? NULL : node->data;
+	for(i = 1; i < n; i++) {
+		check(map->compare(keys[i - 1], keys[i]) <= 0, "Keys aren't sorted.");
 	}
-}
 
-static inline int BSTree_traverse_nodes(BSTreeNode *node, BSTree_traverse_cb traverse_cb)
-{
-	int rc = 0;
+	if(n == 0) return 0;
 
-	if(node->left) {
-		rc = BSTree_traverse_nodes(node->left, traverse_cb);
-		if(rc != 0) return rc;
+	// an emptied map may still have the block of the last build
+	free(map->block);
+	map->block = calloc(n, sizeof(BSTreeNode));
+	check_mem(map->block);
+	map->block_size = n;
+
+	for(i = 0; i < n; i++) {
+		map->block[i].key = keys[i];
+		map->block[i].data = values ? values[i] : NULL;
 	}
 
-	if(node->right) {
-		rc = BSTree_traverse_nodes(node->right, traverse_cb);
-		if(rc != 0) return rc;
+	// the levels above the last one are full, log2(n + 1) of them
+	for(i = n + 1; i > 1; i >>= 1) {
+		black_depth++;
 	}
 
-	return traverse_cb(node);
+	map->root = BSTree_build_nodes(map, NULL, 0, n - 1, 0, black_depth);
+	map->count = n;
+
+	return 0;
+
+error:
+	return -1;
 }
 
-int BSTree_traverse(BSTree *map, BSTree_traverse_cb traverse_cb)
+static inline int BSTree_setnode(BSTree *map, BSTreeNode *node, void *key, void *data)
 {
-	if(map->root) {
-		return BSTree_traverse_nodes(map->root, traverse_cb);
+	BSTreeNode **link = NULL;
+
+	// equal keys go left, after the ones already there
+	for(;;) {
+		link = map->compare(node->key, key) <= 0 ? &node->left : &node->right;
+		if(*link == NULL) break;
+
+		node = *link;
 	}
 
+	*link = BSTreeNode_create(map, node, key, data);
+	check_mem(*link);
+
 	return 0;
+error:
+	return -1;
+}
+
+static inline int BSTree_is_red(BSTreeNode *node)
+{
+	return node != NULL && node->color == BSTREE_RED;
 }
 
 static inline BSTreeNode *BSTree_find_min(BSTreeNode *node)
@@ -177,46 +235,333 @@ static inline void BSTree_swap(BSTreeNode *a, BSTreeNode *b)
 	temp = b->data; b->data = a->data; a->data = temp;	
 }
 
-static inline BSTreeNode *BSTree_node_delete(BSTree *map, BSTreeNode *node, void *key)
+static inline void BSTree_rotate_left(BSTree *map, BSTreeNode *node)
 {
-	int cmp = map->compare(node->key, key);
+	BSTreeNode *right = node->right;
 
-	if(cmp < 0) {
-		if(node->left) {
-			return BSTree_node_delete(map, node->left, key);
+	node->right = right->left;
+	if(right->left) right->left->parent = node;
+
+	BSTree_replace_node_in_parent(map, node, right);
+	right->left = node;
+	node->parent = right;
+}
+
+static inline void BSTree_rotate_right(BSTree *map, BSTreeNode *node)
+{
+	BSTreeNode *left = node->left;
+
+	node->left = left->right;
+	if(left->right) left->right->parent = node;
+
+	BSTree_replace_node_in_parent(map, node, left);
+	left->right = node;
+	node->parent = left;
+}
+
+// restores the red-black rules after a red 'node' was added
+static void BSTree_insert_fixup(BSTree *map, BSTreeNode *node)
+{
+	BSTreeNode *parent = NULL;
+	BSTreeNode *grand = NULL;
+	BSTreeNode *uncle = NULL;
+
+	while((parent = node->parent) != NULL && parent->color == BSTREE_RED) {
+		// a red parent is never the root, so there is a grandparent
+		grand = parent->parent;
+
+		if(parent == grand->left) {
+			uncle = grand->right;
+
+			if(BSTree_is_red(uncle)) {
+				parent->color = BSTREE_BLACK;
+				uncle->color = BSTREE_BLACK;
+				grand->color = BSTREE_RED;
+				node = grand;
+				continue;
+			}
+
+			if(node == parent->right) {
+				BSTree_rotate_left(map, parent);
+				node = parent;
+				parent = node->parent;
+			}
+
+			parent->color = BSTREE_BLACK;
+			grand->color = BSTREE_RED;
+			BSTree_rotate_right(map, grand);
 		} else {
-			// not found
-			return NULL;
+			uncle = grand->left;
+
+			if(BSTree_is_red(uncle)) {
+				parent->color = BSTREE_BLACK;
+				uncle->color = BSTREE_BLACK;
+				grand->color = BSTREE_RED;
+				node = grand;
+				continue;
+			}
+
+			if(node == parent->left) {
+				BSTree_rotate_right(map, parent);
+				node = parent;
+				parent = node->parent;
+			}
+
+			parent->color = BSTREE_BLACK;
+			grand->color = BSTREE_RED;
+			BSTree_rotate_left(map, grand);
 		}
-	} else if(cmp > 0) {
-		if(node->right) {
-			return BSTree_node_delete(map, node->right, key);
-		} else {
-			// not found
-			return NULL;
+	}
+
+	map->root->color = BSTREE_BLACK;
+}
+
+static inline int BSTree_balanced_setnode(BSTree *map, BSTreeNode *node, void *key, void *data)
+{
+	BSTreeNode **link = NULL;
+	int cmp = 0;
+
+	for(;;) {
+		cmp = map->compare(node->key, key);
+
+		if(cmp == 0) {
+			node->data = data;
+			return 0;
 		}
+
+		link = cmp < 0 ? &node->left : &node->right;
+		if(*link == NULL) break;
+
+		node = *link;
+	}
+
+	*link = BSTreeNode_create(map, node, key, data);
+	check_mem(*link);
+
+	(*link)->color = BSTREE_RED;
+	map->count++;
+	BSTree_insert_fixup(map, *link);
+
+	return 0;
+error:
+	return -1;
+}
+
+int BSTree_set(BSTree *map, void *key, void *data)
+{
+	if(map->root == NULL) {
+		// first so just make it and get out, a root is always black
+		map->root = BSTreeNode_create(map, NULL, key, data);
+		check_mem(map->root);
+	} else if(map->engine == BSTREE_RED_BLACK) {
+		return BSTree_balanced_setnode(map, map->root, key, data);
 	} else {
-		if(node->left && node->right) {
-			// swap this node for the smallest node that is bigger than us
-			BSTreeNode *successor = BSTree_find_min(node->right);
-			BSTree_swap(successor, node);
-
-			// this leaves the old successor with possibly a right child
-			// so replace it with the right child
-			BSTree_replace_node_in_parent(map, successor, successor->right);
-
-			// finally it's swapped, so return successor instead of node
-			return successor;
-		} else if(node->left) {
-			BSTree_replace_node_in_parent(map, node, node->left);
-		} else if(node->right) {
-			BSTree_replace_node_in_parent(map, node, node->right);
+		check(BSTree_setnode(map, map->root, key, data) == 0, "Failed to add node.");
+	}
+
+	map->count++;
+
+	return 0;
+error:
+	return -1;
+}
+
+static inline BSTreeNode *BSTree_getnode(BSTree *map, BSTreeNode *node, void *key)
+{
+	int cmp = 0;
+
+	while(node) {
+		cmp = map->compare(node->key, key);
+
+		if(cmp == 0) {
+			return node;
+		}
+
+		node = cmp < 0 ? node->left : node->right;
+	}
+
+	return NULL;
+}
+
+void *BSTree_get(BSTree *map, void *key)
+{
+	BSTreeNode *node = BSTree_getnode(map, map->root, key);
+	return node == NULL ? NULL : node->data;
+}
+
+/*
+ * Walks the tree with the parent pointers, 'from' is the node we came
+ * from. Pre-order and post-order go to the left child first. In-order
+ * is key order, so it starts with the right (smaller) child.
+ */
+static inline int BSTree_traverse_nodes(BSTreeNode *node, BSTreeOrder order, BSTree_traverse_cb traverse_cb)
+{
+	BSTreeNode *from = NULL;
+	BSTreeNode *first = NULL;
+	BSTreeNode *second = NULL;
+	BSTreeNode *parent = NULL;
+	BSTreeNode *top = node->parent;
+	int rc = 0;
+
+	while(node != top) {
+		first = order == BSTREE_IN_ORDER ? node->right : node->left;
+		second = order == BSTREE_IN_ORDER ? node->left : node->right;
+
+		if(from == node->parent) {
+			if(order == BSTREE_PRE_ORDER) {
+				rc = traverse_cb(node);
+				if(rc != 0) return rc;
+			}
+
+			if(first) {
+				from = node;
+				node = first;
+				continue;
+			}
+
+			// no first child, act as if we came back from it
+			from = NULL;
+		}
+
+		if(from == first) {
+			if(order == BSTREE_IN_ORDER) {
+				rc = traverse_cb(node);
+				if(rc != 0) return rc;
+			}
+
+			if(second) {
+				from = node;
+				node = second;
+				continue;
+			}
+		}
+
+		// a post-order callback may free the node, 'from' is only compared
+		parent = node->parent;
+
+		if(order == BSTREE_POST_ORDER) {
+			rc = traverse_cb(node);
+			if(rc != 0) return rc;
+		}
+
+		from = node;
+		node = parent;
+	}
+
+	return 0;
+}
+
+int BSTree_traverse(BSTree *map, BSTree_traverse_cb traverse_cb)
+{
+	return BSTree_traverse_order(map, BSTREE_POST_ORDER, traverse_cb);
+}
+
+int BSTree_traverse_order(BSTree *map, BSTreeOrder order, BSTree_traverse_cb traverse_cb)
+{
+	if(map->root) {
+		return BSTree_traverse_nodes(map->root, order, traverse_cb);
+	}
+
+	return 0;
+}
+
+// restores the red-black rules after a black node was taken from above 'node'
+static void BSTree_delete_fixup(BSTree *map, BSTreeNode *node, BSTreeNode *parent)
+{
+	BSTreeNode *sibling = NULL;
+
+	// 'node' may be NULL, a black node lost means the sibling isn't
+	while(node != map->root && !BSTree_is_red(node)) {
+		if(node == parent->left) {
+			sibling = parent->right;
+
+			if(BSTree_is_red(sibling)) {
+				sibling->color = BSTREE_BLACK;
+				parent->color = BSTREE_RED;
+				BSTree_rotate_left(map, parent);
+				sibling = parent->right;
+			}
+
+			if(!BSTree_is_red(sibling->left) && !BSTree_is_red(sibling->right)) {
+				sibling->color = BSTREE_RED;
+				node = parent;
+				parent = node->parent;
+				continue;
+			}
+
+			if(!BSTree_is_red(sibling->right)) {
+				sibling->left->color = BSTREE_BLACK;
+				sibling->color = BSTREE_RED;
+				BSTree_rotate_right(map, sibling);
+				sibling = parent->right;
+			}
+
+			sibling->color = parent->color;
+			parent->color = BSTREE_BLACK;
+			sibling->right->color = BSTREE_BLACK;
+			BSTree_rotate_left(map, parent);
 		} else {
-			BSTree_replace_node_in_parent(map, node, NULL);
+			sibling = parent->left;
+
+			if(BSTree_is_red(sibling)) {
+				sibling->color = BSTREE_BLACK;
+				parent->color = BSTREE_RED;
+				BSTree_rotate_right(map, parent);
+				sibling = parent->left;
+			}
+
+			if(!BSTree_is_red(sibling->left) && !BSTree_is_red(sibling->right)) {
+				sibling->color = BSTREE_RED;
+				node = parent;
+				parent = node->parent;
+				continue;
+			}
+
+			if(!BSTree_is_red(sibling->left)) {
+				sibling->right->color = BSTREE_BLACK;
+				sibling->color = BSTREE_RED;
+				BSTree_rotate_left(map, sibling);
+				sibling = parent->left;
+			}
+
+			sibling->color = parent->color;
+			parent->color = BSTREE_BLACK;
+			sibling->left->color = BSTREE_BLACK;
+			BSTree_rotate_right(map, parent);
 		}
 
-		return node;
+		node = map->root;
+	}
+
+	if(node) node->color = BSTREE_BLACK;
+}
+
+static inline BSTreeNode *BSTree_node_delete(BSTree *map, BSTreeNode *node, void *key)
+{
+	BSTreeNode *child = NULL;
+
+	node = BSTree_getnode(map, node, key);
+	if(node == NULL) return NULL;
+
+	if(node->left && node->right) {
+		// swap this node for the smallest node that is bigger than us
+		BSTreeNode *successor = BSTree_find_min(node->right);
+		BSTree_swap(successor, node);
+
+		// the old successor has no left child, it's removed instead
+		node = successor;
+	}
+
+	child = node->left ? node->left : node->right;
+	BSTree_replace_node_in_parent(map, node, child);
+
+	if(map->engine == BSTREE_RED_BLACK && node->color == BSTREE_BLACK) {
+		BSTree_delete_fixup(map, child, node->parent);
 	}
+
+	map->count--;
+
+	return node;
 }
 
 void *BSTree_delete(BSTree *map, void *key)
@@ -228,9 +573,101 @@ void *BSTree_delete(BSTree *map, void *key)
 
 		if(node) {
 			data = node->data;
-			free(node);
+			BSTreeNode_destroy(map, node);
 		}
 	}
 
 	return data;
 }
+
+/*
+ * BSTree_setnode keeps bigger keys on the left, so key order is right
+ * subtree, node, left subtree.
+ */
+static inline BSTreeNode *BSTree_smallest(BSTreeNode *node)
+{
+	while(node->right) {
+		node = node->right;
+	}
+
+	return node;
+}
+
+static inline BSTreeNode *BSTree_biggest(BSTreeNode *node)
+{
+	while(node->left) {
+		node = node->left;
+	}
+
+	return node;
+}
+
+BSTreeNode *BSTree_first(BSTree *map)
+{
+	return map->root ? BSTree_smallest(map->root) : NULL;
+}
+
+BSTreeNode *BSTree_last(BSTree *map)
+{
+	return map->root ? BSTree_biggest(map->root) : NULL;
+}
+
+BSTreeNode *BSTree_next(BSTreeNode *node)
+{
+	if(node->left) {
+		return BSTree_smallest(node->left);
+	}
+
+	// climb until we come up from a right (smaller) subtree
+	while(node->parent && node == node->parent->left) {
+		node = node->parent;
+	}
+
+	return node->parent;
+}
+
+BSTreeNode *BSTree_prev(BSTreeNode *node)
+{
+	if(node->right) {
+		return BSTree_biggest(node->right);
+	}
+
+	while(node->parent && node == node->parent->right) {
+		node = node->parent;
+	}
+
+	return node->parent;
+}
+
+BSTreeNode *BSTree_lower_bound(BSTree *map, void *key)
+{
+	BSTreeNode *node = map->root;
+	BSTreeNode *found = NULL;
+
+	while(node) {
+		if(map->compare(node->key, key) >= 0) {
+			// a candidate, but a smaller one may be on the right
+			found = node;
+			node = node->right;
+		} else {
+			node = node->left;
+		}
+	}
+
+	return found;
+}
+
+int BSTree_range(BSTree *map, void *low, void *high, BSTree_range_cb range_cb, void *ctx)
+{
+	BSTreeNode *node = NULL;
+	int rc = 0;
+
+	for(node = BSTree_lower_bound(map, low); node != NULL; node = BSTree_next(node)) {
+		if(map->compare(node->key, high) > 0) break;
+
+		rc = range_cb(node, ctx);
+		if(rc != 0) return rc;
+	}
+
+	return 0;
+}
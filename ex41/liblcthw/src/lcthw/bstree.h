@@ -1,8 +1,20 @@
 #ifndef _lcthw_BSTree_h
 #define _lcthw_BSTree_h
 
+#include <lcthw/pool.h>
+
 typedef int (*BSTree_compare)(void *a, void *b);
 
+typedef enum BSTreeEngine {
+	BSTREE_PLAIN = 0,		// never rebalanced, every set adds a node
+	BSTREE_RED_BLACK		// height at most 2 log2(n + 1), set replaces equal keys
+} BSTreeEngine;
+
+typedef enum BSTreeColor {
+	BSTREE_BLACK = 0,
+	BSTREE_RED
+} BSTreeColor;
+
 typedef struct BSTreeNode {
 	void *key;
 	void *data;
@@ -10,24 +22,85 @@ typedef struct BSTreeNode {
 	struct BSTreeNode *left;
 	struct BSTreeNode *right;
 	struct BSTreeNode *parent;
+	BSTreeColor color;		// BSTREE_RED_BLACK only
 } BSTreeNode;
 
 typedef struct BSTree {
 	int count;
+	BSTreeEngine engine;
 	BSTree_compare compare;
 	BSTreeNode *root;
+	Pool *pool;
+	BSTreeNode *block;		// nodes made by BSTree_build_sorted
+	int block_size;
 } BSTree;
 
+typedef enum BSTreeOrder {
+	BSTREE_POST_ORDER = 0,	// children first, left then right
+	BSTREE_PRE_ORDER,		// node first, then left and right
+	BSTREE_IN_ORDER			// key order
+} BSTreeOrder;
+
 typedef int (*BSTree_traverse_cb)(BSTreeNode *node);
+typedef int (*BSTree_range_cb)(BSTreeNode *node, void *ctx);
 
 BSTree *BSTree_create(BSTree_compare compare);
+
+// nodes are taken from 'pool' owned by the caller, see Hashmap_create_pooled
+BSTree *BSTree_create_pooled(BSTree_compare compare, Pool *pool);
+
+/*
+ * Red-black tree with the same API: sorted or nearly sorted keys don't
+ * turn it into a list. Unlike the plain tree, setting a key that is
+ * already there replaces its data.
+ */
+BSTree *BSTree_create_balanced(BSTree_compare compare);
+
 void BSTree_destroy(BSTree *map);
 
+/*
+ * Fills an empty map with 'n' keys sorted by map->compare (distinct for
+ * the red-black engine) in O(n). The tree is perfectly balanced and its
+ * nodes are one contiguous block in key order. 'values' may be NULL.
+ */
+int BSTree_build_sorted(BSTree *map, void **keys, void **values, int n);
+
 int BSTree_set(BSTree *map, void *key, void *data);
 void *BSTree_get(BSTree *map, void *key);
 
+// post-order, like BSTree_traverse_order with BSTREE_POST_ORDER
 int BSTree_traverse(BSTree *map, BSTree_traverse_cb traverse_cb);
 
+/*
+ * Calls 'traverse_cb' for every node in 'order' and stops at the first
+ * nonzero result. Walks the parent pointers without recursion, so any
+ * tree depth is fine.
+ */
+int BSTree_traverse_order(BSTree *map, BSTreeOrder order, BSTree_traverse_cb traverse_cb);
+
 void *BSTree_delete(BSTree *map, void *key);
 
+/*
+ * In-order cursor over the parent pointers, no recursion and no stack:
+ *
+ *   for(node = BSTree_lower_bound(map, from); node; node = BSTree_next(node)) { ... }
+ *
+ * BSTree_first and BSTree_last give the smallest and the biggest key,
+ * BSTree_lower_bound the first node with a key not less than 'key'
+ * (NULL when there is none). Equal keys of the plain tree come in the
+ * order they were set. A set or delete invalidates the nodes held.
+ */
+BSTreeNode *BSTree_first(BSTree *map);
+BSTreeNode *BSTree_last(BSTree *map);
+BSTreeNode *BSTree_lower_bound(BSTree *map, void *key);
+BSTreeNode *BSTree_next(BSTreeNode *node);
+BSTreeNode *BSTree_prev(BSTreeNode *node);
+
+/*
+ * Calls 'range_cb' in key order for every node with a key in [low, high],
+ * O(log n + k) for k nodes. Stops at the first nonzero result and
+ * returns it.
+ */
+int BSTree_range(BSTree *map, void *low, void *high, BSTree_range_cb range_cb, void *ctx);
+
 #endif
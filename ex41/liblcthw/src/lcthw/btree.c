@@ -0,0 +1,427 @@
+#include <lcthw/dbg.h>
+#include <lcthw/btree.h>
+#include <lcthw/bstrlib.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int default_compare(void *a, void *b)
+{
+	return bstrcmp((bstring)a, (bstring)b);
+}
+
+static BTreeNode *BTreeNode_create(int leaf)
+{
+	BTreeNode *node = NULL;
+
+	check(posix_memalign((void **)&node, CACHE_LINE_SIZE, sizeof(BTreeNode)) == 0, "Out of memory.");
+
+	node->count = 0;
+	node->leaf = leaf;
+	node->next = NULL;
+
+	return node;
+
+error:
+	return NULL;
+}
+
+BTree *BTree_create(BSTree_compare compare)
+{
+	BTree *map = calloc(1, sizeof(BTree));
+	check_mem(map);
+
+	map->compare = compare == NULL ? default_compare : compare;
+
+	map->root = BTreeNode_create(1);
+	check_mem(map->root);
+	map->height = 1;
+
+	return map;
+
+error:
+	if(map) free(map);
+	return NULL;
+}
+
+void BTree_destroy(BTree *map)
+{
+	BTreeNode *path[BTREE_MAX_HEIGHT];
+	int next[BTREE_MAX_HEIGHT];
+	BTreeNode *node = NULL;
+	int depth = 0;
+
+	if(map) {
+		path[0] = map->root;
+		next[0] = 0;
+
+		// a node is freed after all of its children
+		while(depth >= 0) {
+			node = path[depth];
+
+			if(node->leaf || next[depth] > node->count) {
+				free(node);
+				depth--;
+			} else {
+				path[depth + 1] = node->children[next[depth]++];
+				next[depth + 1] = 0;
+				depth++;
+			}
+		}
+
+		free(map);
+	}
+}
+
+// index of the first key not less than 'key'
+static inline int BTree_lower_bound(BTree *map, BTreeNode *node, void *key)
+{
+	int low = 0;
+	int high = node->count;
+	int middle = 0;
+
+	while(low < high) {
+		middle = low + (high - low) / 2;
+
+		if(map->compare(node->keys[middle], key) < 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
+// index of the child of an inner node that may hold 'key'
+static inline int BTree_child_index(BTree *map, BTreeNode *node, void *key)
+{
+	int low = 0;
+	int high = node->count;
+	int middle = 0;
+
+	while(low < high) {
+		middle = low + (high - low) / 2;
+
+		if(map->compare(node->keys[middle], key) <= 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
+static inline BTreeNode *BTree_find_leaf(BTree *map, void *key)
+{
+	BTreeNode *node = map->root;
+
+	while(!node->leaf) {
+		node = node->children[BTree_child_index(map, node, key)];
+	}
+
+	return node;
+}
+
+void *BTree_get(BTree *map, void *key)
+{
+	BTreeNode *leaf = BTree_find_leaf(map, key);
+	int i = BTree_lower_bound(map, leaf, key);
+
+	if(i < leaf->count && map->compare(leaf->keys[i], key) == 0) {
+		return leaf->data[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Splits the full child 'i' of 'parent' in two. A leaf split copies
+ * the first key of the new right leaf to the parent, an inner split
+ * moves its middle key up.
+ */
+static int BTree_split_child(BTreeNode *parent, int i)
+{
+	BTreeNode *child = parent->children[i];
+	BTreeNode *right = BTreeNode_create(child->leaf);
+	int half = BTREE_MAX_KEYS / 2;
+	void *separator = NULL;
+
+	check_mem(right);
+
+	if(child->leaf) {
+		right->count = child->count - half;
+		memcpy(right->keys, child->keys + half, right->count * sizeof(void *));
+		memcpy(right->data, child->data + half, right->count * sizeof(void *));
+		child->count = half;
+
+		right->next = child->next;
+		child->next = right;
+		separator = right->keys[0];
+	} else {
+		right->count = child->count - half - 1;
+		memcpy(right->keys, child->keys + half + 1, right->count * sizeof(void *));
+		memcpy(right->children, child->children + half + 1, (right->count + 1) * sizeof(BTreeNode *));
+		separator = child->keys[half];
+		child->count = half;
+	}
+
+	memmove(parent->keys + i + 1, parent->keys + i, (parent->count - i) * sizeof(void *));
+	memmove(parent->children + i + 2, parent->children + i + 1, (parent->count - i) * sizeof(BTreeNode *));
+	parent->keys[i] = separator;
+	parent->children[i + 1] = right;
+	parent->count++;
+
+	return 0;
+
+error:
+	return -1;
+}
+
+int BTree_set(BTree *map, void *key, void *data)
+{
+	BTreeNode *node = map->root;
+	int i = 0;
+
+	// full nodes are split on the way down, so a split never goes up
+	if(node->count == BTREE_MAX_KEYS) {
+		BTreeNode *root = BTreeNode_create(0);
+		check_mem(root);
+
+		root->children[0] = node;
+		if(BTree_split_child(root, 0) != 0) {
+			free(root);
+			sentinel("Failed to split the root.");
+		}
+
+		map->root = node = root;
+		map->height++;
+	}
+
+	while(!node->leaf) {
+		i = BTree_child_index(map, node, key);
+
+		if(node->children[i]->count == BTREE_MAX_KEYS) {
+			check(BTree_split_child(node, i) == 0, "Failed to split a node.");
+
+			if(map->compare(node->keys[i], key) <= 0) i++;
+		}
+
+		node = node->children[i];
+	}
+
+	i = BTree_lower_bound(map, node, key);
+
+	if(i < node->count && map->compare(node->keys[i], key) == 0) {
+		node->data[i] = data;
+		return 0;
+	}
+
+	memmove(node->keys + i + 1, node->keys + i, (node->count - i) * sizeof(void *));
+	memmove(node->data + i + 1, node->data + i, (node->count - i) * sizeof(void *));
+	node->keys[i] = key;
+	node->data[i] = data;
+	node->count++;
+	map->count++;
+
+	return 0;
+
+error:
+	return -1;
+}
+
+// removes key 'i' and the child right of it from an inner node
+static inline void BTree_remove_separator(BTreeNode *node, int i)
+{
+	memmove(node->keys + i, node->keys + i + 1, (node->count - i - 1) * sizeof(void *));
+	memmove(node->children + i + 1, node->children + i + 2, (node->count - i - 1) * sizeof(BTreeNode *));
+	node->count--;
+}
+
+// moves the last entry of 'left' to the front of 'node', 'i' is the index of 'node' in 'parent'
+static void BTree_borrow_left(BTreeNode *parent, int i, BTreeNode *left, BTreeNode *node)
+{
+	memmove(node->keys + 1, node->keys, node->count * sizeof(void *));
+
+	if(node->leaf) {
+		memmove(node->data + 1, node->data, node->count * sizeof(void *));
+		node->keys[0] = left->keys[left->count - 1];
+		node->data[0] = left->data[left->count - 1];
+		parent->keys[i - 1] = node->keys[0];
+	} else {
+		memmove(node->children + 1, node->children, (node->count + 1) * sizeof(BTreeNode *));
+		node->keys[0] = parent->keys[i - 1];
+		node->children[0] = left->children[left->count];
+		parent->keys[i - 1] = left->keys[left->count - 1];
+	}
+
+	node->count++;
+	left->count--;
+}
+
+// moves the first entry of 'right' to the end of 'node'
+static void BTree_borrow_right(BTreeNode *parent, int i, BTreeNode *node, BTreeNode *right)
+{
+	if(node->leaf) {
+		node->keys[node->count] = right->keys[0];
+		node->data[node->count] = right->data[0];
+		memmove(right->data, right->data + 1, (right->count - 1) * sizeof(void *));
+		memmove(right->keys, right->keys + 1, (right->count - 1) * sizeof(void *));
+		parent->keys[i] = right->keys[0];
+	} else {
+		node->keys[node->count] = parent->keys[i];
+		node->children[node->count + 1] = right->children[0];
+		parent->keys[i] = right->keys[0];
+		memmove(right->keys, right->keys + 1, (right->count - 1) * sizeof(void *));
+		memmove(right->children, right->children + 1, right->count * sizeof(BTreeNode *));
+	}
+
+	node->count++;
+	right->count--;
+}
+
+// appends 'right', the child i + 1 of 'parent', to 'left' and frees it
+static void BTree_merge(BTreeNode *parent, int i, BTreeNode *left, BTreeNode *right)
+{
+	if(left->leaf) {
+		memcpy(left->keys + left->count, right->keys, right->count * sizeof(void *));
+		memcpy(left->data + left->count, right->data, right->count * sizeof(void *));
+		left->count += right->count;
+		left->next = right->next;
+	} else {
+		left->keys[left->count] = parent->keys[i];
+		memcpy(left->keys + left->count + 1, right->keys, right->count * sizeof(void *));
+		memcpy(left->children + left->count + 1, right->children, (right->count + 1) * sizeof(BTreeNode *));
+		left->count += right->count + 1;
+	}
+
+	BTree_remove_separator(parent, i);
+	free(right);
+}
+
+void *BTree_delete(BTree *map, void *key)
+{
+	BTreeNode *path[BTREE_MAX_HEIGHT];
+	int indexes[BTREE_MAX_HEIGHT];
+	BTreeNode *node = map->root;
+	BTreeNode *parent = NULL;
+	void *data = NULL;
+	int depth = 0;
+	int level = 0;
+	int i = 0;
+
+	// remember the way down, underfull nodes are fixed on the way up
+	while(!node->leaf) {
+		path[depth] = node;
+		indexes[depth] = BTree_child_index(map, node, key);
+		node = node->children[indexes[depth]];
+		depth++;
+	}
+
+	i = BTree_lower_bound(map, node, key);
+	if(i == node->count || map->compare(node->keys[i], key) != 0) return NULL;
+
+	data = node->data[i];
+	memmove(node->keys + i, node->keys + i + 1, (node->count - i - 1) * sizeof(void *));
+	memmove(node->data + i, node->data + i + 1, (node->count - i - 1) * sizeof(void *));
+	node->count--;
+	map->count--;
+
+	// the first key of a leaf is the separator in the nearest ancestor
+	// it isn't the leftmost child of, it can't be left there for the
+	// caller to free, so the next key takes its place (a leaf below the
+	// root has BTREE_MIN_KEYS - 1 keys at least)
+	for(level = depth - 1; i == 0 && level >= 0; level--) {
+		if(indexes[level] > 0) {
+			path[level]->keys[indexes[level] - 1] = node->keys[0];
+			break;
+		}
+	}
+
+	while(depth > 0 && node->count < BTREE_MIN_KEYS) {
+		depth--;
+		parent = path[depth];
+		i = indexes[depth];
+
+		BTreeNode *left = i > 0 ? parent->children[i - 1] : NULL;
+		BTreeNode *right = i < parent->count ? parent->children[i + 1] : NULL;
+
+		if(left && left->count > BTREE_MIN_KEYS) {
+			BTree_borrow_left(parent, i, left, node);
+		} else if(right && right->count > BTREE_MIN_KEYS) {
+			BTree_borrow_right(parent, i, node, right);
+		} else if(left) {
+			BTree_merge(parent, i - 1, left, node);
+		} else {
+			BTree_merge(parent, i, node, right);
+		}
+
+		node = parent;
+	}
+
+	// an inner root left with one child gives its place to it
+	if(!map->root->leaf && map->root->count == 0) {
+		node = map->root;
+		map->root = node->children[0];
+		map->height--;
+		free(node);
+	}
+
+	return data;
+}
+
+static inline BTreeNode *BTree_first_leaf(BTree *map)
+{
+	BTreeNode *node = map->root;
+
+	while(!node->leaf) {
+		node = node->children[0];
+	}
+
+	return node;
+}
+
+int BTree_traverse(BTree *map, BTree_traverse_cb traverse_cb)
+{
+	BTreeNode *leaf = NULL;
+	int rc = 0;
+	int i = 0;
+
+	for(leaf = BTree_first_leaf(map); leaf != NULL; leaf = leaf->next) {
+		for(i = 0; i < leaf->count; i++) {
+			rc = traverse_cb(leaf->keys[i], leaf->data[i]);
+			if(rc != 0) return rc;
+		}
+	}
+
+	return 0;
+}
+
+void BTree_iter_init(BTree *map, BTreeIter *iter)
+{
+	iter->leaf = BTree_first_leaf(map);
+	iter->index = 0;
+}
+
+void BTree_iter_seek(BTree *map, BTreeIter *iter, void *key)
+{
+	iter->leaf = BTree_find_leaf(map, key);
+	iter->index = BTree_lower_bound(map, iter->leaf, key);
+}
+
+int BTree_iter_next(BTreeIter *iter, void **key, void **data)
+{
+	// empty leaves are only possible as the root, but skip any
+	while(iter->leaf && iter->index == iter->leaf->count) {
+		iter->leaf = iter->leaf->next;
+		iter->index = 0;
+	}
+
+	if(iter->leaf == NULL) return 0;
+
+	if(key) *key = iter->leaf->keys[iter->index];
+	if(data) *data = iter->leaf->data[iter->index];
+	iter->index++;
+
+	return 1;
+}
@@ -0,0 +1,89 @@
+#ifndef _lcthw_BTree_h
+#define _lcthw_BTree_h
+
+#include <stdint.h>
+#include <lcthw/bstree.h>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// the keys of a node fill four cache lines, a search touches about three
+#define BTREE_MAX_KEYS (4 * CACHE_LINE_SIZE / (int)sizeof(void *))
+#define BTREE_MIN_KEYS (BTREE_MAX_KEYS / 2 - 1)
+
+// 16 levels of at least BTREE_MIN_KEYS + 1 children hold any tree in memory
+#define BTREE_MAX_HEIGHT 16
+
+/*
+ * Keys are kept sorted and contiguous in every node. Inner nodes only
+ * route: children[i] has the keys not less than keys[i - 1] and less
+ * than keys[i], and keys[i - 1] is the smallest key of children[i], so
+ * inner nodes never point to a deleted key. All keys and data are in
+ * the leaves, which are linked in key order for scans.
+ */
+typedef struct BTreeNode {
+	int count;
+	int leaf;
+	void *keys[BTREE_MAX_KEYS];
+	union {
+		struct BTreeNode *children[BTREE_MAX_KEYS + 1];
+		struct {
+			void *data[BTREE_MAX_KEYS];
+			struct BTreeNode *next;
+		};
+	};
+} BTreeNode;
+
+/*
+ * B+ tree ordered map: the same keys, compare callback and set, get,
+ * delete semantics as BSTree_create_balanced, but one node holds
+ * BTREE_MAX_KEYS keys, so a lookup of tens of millions of keys takes
+ * four or five node visits instead of over twenty pointer chases.
+ */
+typedef struct BTree {
+	int count;
+	int height;
+	BSTree_compare compare;
+	BTreeNode *root;
+} BTree;
+
+typedef int (*BTree_traverse_cb)(void *key, void *data);
+
+// keys are walked in order from the leaf 'leaf' at 'index'
+typedef struct BTreeIter {
+	BTreeNode *leaf;
+	int index;
+} BTreeIter;
+
+BTree *BTree_create(BSTree_compare compare);
+
+void BTree_destroy(BTree *map);
+
+// set replaces the data of a key that is already there
+int BTree_set(BTree *map, void *key, void *data);
+void *BTree_get(BTree *map, void *key);
+
+void *BTree_delete(BTree *map, void *key);
+
+// calls 'traverse_cb' in key order, stops at the first nonzero result
+int BTree_traverse(BTree *map, BTree_traverse_cb traverse_cb);
+
+/*
+ * Ordered iteration:
+ *
+ *   BTreeIter iter;
+ *   BTree_iter_seek(map, &iter, from);
+ *   while(BTree_iter_next(&iter, &key, &data)) { ... }
+ *
+ * BTree_iter_init starts at the smallest key, BTree_iter_seek at the
+ * smallest key not less than 'key'. Any set or delete invalidates the
+ * iterator.
+ */
+void BTree_iter_init(BTree *map, BTreeIter *iter);
+void BTree_iter_seek(BTree *map, BTreeIter *iter, void *key);
+
+// 1 and the next key and data (either pointer may be NULL) or 0 at the end
+int BTree_iter_next(BTreeIter *iter, void **key, void **data);
+
+#endif
@@ -0,0 +1,477 @@
+#include <lcthw/concurrent_hashmap.h>
+#include <lcthw/hashmap_algos.h>
+#include <lcthw/bstrlib.h>
+#include <lcthw/dbg.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+/*
+ * Every reading thread owns an EpochReader slot. While it reads it
+ * holds the global epoch it saw on entry, 0 means it doesn't read.
+ * Memory retired at epoch E can be freed when no slot holds E or less.
+ * Slots are never freed, a thread gives its slot back on exit.
+ */
+typedef struct EpochReader {
+	_Atomic uint64_t epoch;
+	atomic_int in_use;
+	struct EpochReader *next;
+} __attribute__((aligned(CACHE_LINE_SIZE))) EpochReader;
+
+static _Atomic uint64_t global_epoch = 1;
+static EpochReader *_Atomic readers = NULL;
+
+static pthread_once_t reader_once = PTHREAD_ONCE_INIT;
+static pthread_key_t reader_key;
+
+static __thread EpochReader *local_reader = NULL;
+static __thread uint32_t local_depth = 0;
+
+#define RETIRED_NODE(R) ((ConcurrentHashmapNode *)((char *)(R) - offsetof(ConcurrentHashmapNode, retired)))
+#define RETIRED_TABLE(R) ((ConcurrentHashmapTable *)((char *)(R) - offsetof(ConcurrentHashmapTable, retired)))
+
+static int default_compare(void **a, void **b)
+{
+	return bstrcmp((bstring)((HashmapNode *)*a)->key, (bstring)((HashmapNode *)*b)->key);
+}
+
+static void Epoch_reader_release(void *reader)
+{
+	atomic_store(&((EpochReader *)reader)->epoch, 0);
+	atomic_store(&((EpochReader *)reader)->in_use, 0);
+}
+
+static void Epoch_key_create(void)
+{
+	pthread_key_create(&reader_key, Epoch_reader_release);
+}
+
+static EpochReader *Epoch_reader_register(void)
+{
+	EpochReader *reader = NULL;
+	int free_slot = 0;
+
+	pthread_once(&reader_once, Epoch_key_create);
+
+	for(reader = atomic_load(&readers); reader != NULL; reader = reader->next) {
+		free_slot = 0;
+		if(atomic_compare_exchange_strong(&reader->in_use, &free_slot, 1)) break;
+	}
+
+	if(reader == NULL) {
+		check(posix_memalign((void **)&reader, CACHE_LINE_SIZE, sizeof(EpochReader)) == 0, "Out of memory.");
+		atomic_init(&reader->epoch, 0);
+		atomic_init(&reader->in_use, 1);
+
+		reader->next = atomic_load(&readers);
+		while(!atomic_compare_exchange_weak(&readers, &reader->next, reader));
+	}
+
+	pthread_setspecific(reader_key, reader);
+	local_reader = reader;
+
+	return reader;
+
+error:
+	return NULL;
+}
+
+static inline EpochReader *Epoch_enter(void)
+{
+	EpochReader *reader = local_reader != NULL ? local_reader : Epoch_reader_register();
+
+	if(reader != NULL && local_depth++ == 0) {
+		atomic_store_explicit(&reader->epoch,
+				atomic_load_explicit(&global_epoch, memory_order_acquire), memory_order_relaxed);
+		// pairs with the fence in ConcurrentHashmap_reclaim
+		atomic_thread_fence(memory_order_seq_cst);
+	}
+
+	return reader;
+}
+
+static inline void Epoch_exit(EpochReader *reader)
+{
+	if(--local_depth == 0) {
+		atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+	}
+}
+
+// the oldest epoch a reader is in, readers of later epochs can't see retired memory
+static uint64_t Epoch_oldest(void)
+{
+	EpochReader *reader = NULL;
+	uint64_t oldest = UINT64_MAX;
+	uint64_t epoch = 0;
+
+	atomic_thread_fence(memory_order_seq_cst);
+
+	for(reader = atomic_load(&readers); reader != NULL; reader = reader->next) {
+		epoch = atomic_load_explicit(&reader->epoch, memory_order_acquire);
+
+		if(epoch != 0 && epoch < oldest) {
+			oldest = epoch;
+		}
+	}
+
+	return oldest;
+}
+
+static inline void Epoch_retire(EpochRetired **list, EpochRetired *retired)
+{
+	// a reader in a later epoch entered after the memory was unlinked
+	retired->epoch = atomic_fetch_add(&global_epoch, 1);
+	retired->next = *list;
+	*list = retired;
+}
+
+static ConcurrentHashmapTable *ConcurrentHashmap_table_create(uint32_t buckets_number)
+{
+	ConcurrentHashmapTable *table = calloc(1, sizeof(ConcurrentHashmapTable) +
+			buckets_number * sizeof(ConcurrentHashmapNode *));
+	check_mem(table);
+
+	table->buckets_number = buckets_number;
+
+	return table;
+
+error:
+	return NULL;
+}
+
+// frees the nodes too, only for tables that were never published or aren't read any more
+static void ConcurrentHashmap_table_destroy(ConcurrentHashmapTable *table)
+{
+	ConcurrentHashmapNode *node = NULL;
+	ConcurrentHashmapNode *next = NULL;
+	uint32_t i = 0;
+
+	for(i = 0; i < table->buckets_number; i++) {
+		for(node = atomic_load_explicit(&table->buckets[i], memory_order_relaxed); node != NULL; node = next) {
+			next = atomic_load_explicit(&node->next, memory_order_relaxed);
+			free(node);
+		}
+	}
+
+	free(table);
+}
+
+ConcurrentHashmap *ConcurrentHashmap_create(Hashmap_compare compare, Hashmap_hash hash, uint32_t buckets_number)
+{
+	uint32_t rounded = 1;
+	ConcurrentHashmap *map = NULL;
+
+	check(posix_memalign((void **)&map, CACHE_LINE_SIZE, sizeof(ConcurrentHashmap)) == 0, "Out of memory.");
+	memset(map, 0, sizeof(ConcurrentHashmap));
+
+	map->compare = compare == NULL ? (Hashmap_compare)default_compare : compare;
+	map->hash = hash == NULL ? default_hash : hash;
+
+	buckets_number = buckets_number == 0 ? DEFAULT_NUMBER_OF_CONCURRENT_BUCKETS : buckets_number;
+	check(buckets_number <= (1UL << 31), "Too many buckets: %u", buckets_number);
+	while(rounded < buckets_number) rounded <<= 1;
+
+	ConcurrentHashmapTable *table = ConcurrentHashmap_table_create(rounded);
+	check(table, "Failed to create table.");
+	atomic_init(&map->table, table);
+	atomic_init(&map->counter, 0);
+	map->reclaim_at = EPOCH_RECLAIM_THRESHOLD;
+
+	check(pthread_mutex_init(&map->write_lock, NULL) == 0, "Failed to init write lock.");
+
+	return map;
+
+error:
+	if(map) {
+		if(map->table) {
+			ConcurrentHashmap_table_destroy(map->table);
+		}
+		free(map);
+	}
+
+	return NULL;
+}
+
+// returns the number of kept entries
+static uint32_t ConcurrentHashmap_free_retired(EpochRetired **list, uint64_t oldest, int tables)
+{
+	EpochRetired **link = list;
+	EpochRetired *retired = NULL;
+	EpochRetired *next = NULL;
+	uint32_t kept = 0;
+
+	// the list goes from the newest epoch to the oldest
+	while(*link != NULL && (*link)->epoch >= oldest) {
+		link = &(*link)->next;
+		kept++;
+	}
+
+	for(retired = *link; retired != NULL; retired = next) {
+		next = retired->next;
+
+		// a retired table has no nodes of its own, they were retired one by one
+		if(tables) {
+			free(RETIRED_TABLE(retired));
+		} else {
+			free(RETIRED_NODE(retired));
+		}
+	}
+
+	*link = NULL;
+
+	return kept;
+}
+
+static void ConcurrentHashmap_reclaim_locked(ConcurrentHashmap *map)
+{
+	uint64_t oldest = Epoch_oldest();
+
+	map->retired_number = ConcurrentHashmap_free_retired(&map->retired_nodes, oldest, 0);
+	ConcurrentHashmap_free_retired(&map->retired_tables, oldest, 1);
+
+	// a slow reader can keep a lot of memory, don't walk it on every retire
+	map->reclaim_at = map->retired_number * 2 + EPOCH_RECLAIM_THRESHOLD;
+}
+
+void ConcurrentHashmap_reclaim(ConcurrentHashmap *map)
+{
+	pthread_mutex_lock(&map->write_lock);
+	ConcurrentHashmap_reclaim_locked(map);
+	pthread_mutex_unlock(&map->write_lock);
+}
+
+static inline void ConcurrentHashmap_retire_node(ConcurrentHashmap *map, ConcurrentHashmapNode *node)
+{
+	Epoch_retire(&map->retired_nodes, &node->retired);
+
+	if(++map->retired_number >= map->reclaim_at) {
+		ConcurrentHashmap_reclaim_locked(map);
+	}
+}
+
+void ConcurrentHashmap_destroy(ConcurrentHashmap *map)
+{
+	if(map) {
+		ConcurrentHashmap_free_retired(&map->retired_nodes, UINT64_MAX, 0);
+		ConcurrentHashmap_free_retired(&map->retired_tables, UINT64_MAX, 1);
+		ConcurrentHashmap_table_destroy(atomic_load(&map->table));
+		pthread_mutex_destroy(&map->write_lock);
+		free(map);
+	}
+}
+
+// readers keep walking the old table, so the nodes are copied, not moved
+static int ConcurrentHashmap_grow(ConcurrentHashmap *map)
+{
+	ConcurrentHashmapTable *old = atomic_load_explicit(&map->table, memory_order_relaxed);
+	ConcurrentHashmapNode *node = NULL;
+	ConcurrentHashmapNode *next = NULL;
+	ConcurrentHashmapNode *copy = NULL;
+	uint32_t i = 0;
+	uint32_t bucket_n = 0;
+
+	check(old->buckets_number < (1UL << 31), "Can't grow buckets any more.");
+
+	ConcurrentHashmapTable *table = ConcurrentHashmap_table_create(old->buckets_number * 2);
+	check(table, "Failed to create table.");
+
+	for(i = 0; i < old->buckets_number; i++) {
+		for(node = atomic_load_explicit(&old->buckets[i], memory_order_relaxed); node != NULL;
+				node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+			copy = malloc(sizeof(ConcurrentHashmapNode));
+			if(copy == NULL) {
+				ConcurrentHashmap_table_destroy(table);
+				sentinel("Out of memory.");
+			}
+
+			copy->node = node->node;
+			bucket_n = node->node.hash & (table->buckets_number - 1);
+			atomic_init(&copy->next, atomic_load_explicit(&table->buckets[bucket_n], memory_order_relaxed));
+			atomic_init(&table->buckets[bucket_n], copy);
+		}
+	}
+
+	atomic_store_explicit(&map->table, table, memory_order_release);
+
+	for(i = 0; i < old->buckets_number; i++) {
+		for(node = atomic_load_explicit(&old->buckets[i], memory_order_relaxed); node != NULL; node = next) {
+			next = atomic_load_explicit(&node->next, memory_order_relaxed);
+			Epoch_retire(&map->retired_nodes, &node->retired);
+			map->retired_number++;
+		}
+	}
+
+	Epoch_retire(&map->retired_tables, &old->retired);
+	ConcurrentHashmap_reclaim_locked(map);
+
+	return 0;
+
+error:
+	return -1;
+}
+
+// returns the link pointing to the node with 'key' or to the end of the bucket
+static ConcurrentHashmapNode *_Atomic *ConcurrentHashmap_find_link(ConcurrentHashmap *map,
+		ConcurrentHashmapTable *table, uint32_t hash, void *key)
+{
+	HashmapNode probe = {.key = key, .data = NULL, .hash = hash};
+	HashmapNode *probe_ptr = &probe;
+	HashmapNode *found = NULL;
+	ConcurrentHashmapNode *_Atomic *link = &table->buckets[hash & (table->buckets_number - 1)];
+	ConcurrentHashmapNode *node = NULL;
+
+	while((node = atomic_load_explicit(link, memory_order_relaxed)) != NULL) {
+		found = &node->node;
+		if(node->node.hash == hash && map->compare(&probe_ptr, &found) == 0) {
+			break;
+		}
+
+		link = &node->next;
+	}
+
+	return link;
+}
+
+int ConcurrentHashmap_set(ConcurrentHashmap *map, void *key, void *data)
+{
+	check(map, "map can't be NULL");
+	check(key, "key can't be NULL");
+	check(data, "data can't be NULL");
+
+	uint32_t hash = map->hash(key);
+
+	pthread_mutex_lock(&map->write_lock);
+
+	ConcurrentHashmapTable *table = atomic_load_explicit(&map->table, memory_order_relaxed);
+	ConcurrentHashmapNode *_Atomic *link = ConcurrentHashmap_find_link(map, table, hash, key);
+	ConcurrentHashmapNode *old = atomic_load_explicit(link, memory_order_relaxed);
+
+	if(old == NULL && atomic_load_explicit(&map->counter, memory_order_relaxed) >= table->buckets_number) {
+		if(ConcurrentHashmap_grow(map) == 0) {
+			table = atomic_load_explicit(&map->table, memory_order_relaxed);
+			link = ConcurrentHashmap_find_link(map, table, hash, key);
+		}
+	}
+
+	ConcurrentHashmapNode *node = malloc(sizeof(ConcurrentHashmapNode));
+	if(node == NULL) {
+		pthread_mutex_unlock(&map->write_lock);
+		sentinel("Out of memory.");
+	}
+
+	node->node.key = key;
+	node->node.data = data;
+	node->node.hash = hash;
+
+	if(old != NULL) {
+		// the node takes the place of the old one, which readers may still hold
+		atomic_init(&node->next, atomic_load_explicit(&old->next, memory_order_relaxed));
+		atomic_store_explicit(link, node, memory_order_release);
+		ConcurrentHashmap_retire_node(map, old);
+	} else {
+		atomic_init(&node->next, NULL);
+		atomic_store_explicit(link, node, memory_order_release);
+		atomic_fetch_add_explicit(&map->counter, 1, memory_order_relaxed);
+	}
+
+	pthread_mutex_unlock(&map->write_lock);
+
+	return 0;
+
+error:
+	return -1;
+}
+
+void *ConcurrentHashmap_get(ConcurrentHashmap *map, void *key)
+{
+	check(map, "map can't be NULL");
+	check(key, "key can't be NULL");
+
+	uint32_t hash = map->hash(key);
+	HashmapNode probe = {.key = key, .data = NULL, .hash = hash};
+	HashmapNode *probe_ptr = &probe;
+	HashmapNode *found = NULL;
+	void *data = NULL;
+
+	EpochReader *reader = Epoch_enter();
+	check(reader, "Failed to register reader.");
+
+	ConcurrentHashmapTable *table = atomic_load_explicit(&map->table, memory_order_acquire);
+	ConcurrentHashmapNode *node = atomic_load_explicit(&table->buckets[hash & (table->buckets_number - 1)],
+			memory_order_acquire);
+
+	for(; node != NULL; node = atomic_load_explicit(&node->next, memory_order_acquire)) {
+		found = &node->node;
+		if(node->node.hash == hash && map->compare(&probe_ptr, &found) == 0) {
+			data = node->node.data;
+			break;
+		}
+	}
+
+	Epoch_exit(reader);
+
+	return data;
+
+error:
+	return NULL;
+}
+
+int ConcurrentHashmap_traverse(ConcurrentHashmap *map, Hashmap_traverse_cb traverse_cb)
+{
+	ConcurrentHashmapNode *node = NULL;
+	uint32_t i = 0;
+	int rc = 0;
+
+	EpochReader *reader = Epoch_enter();
+	check(reader, "Failed to register reader.");
+
+	ConcurrentHashmapTable *table = atomic_load_explicit(&map->table, memory_order_acquire);
+
+	for(i = 0; i < table->buckets_number && rc == 0; i++) {
+		for(node = atomic_load_explicit(&table->buckets[i], memory_order_acquire); node != NULL && rc == 0;
+				node = atomic_load_explicit(&node->next, memory_order_acquire)) {
+			rc = traverse_cb(&node->node);
+		}
+	}
+
+	Epoch_exit(reader);
+
+	return rc;
+
+error:
+	return -1;
+}
+
+void *ConcurrentHashmap_delete(ConcurrentHashmap *map, void *key)
+{
+	check(map, "map can't be NULL");
+	check(key, "key can't be NULL");
+
+	uint32_t hash = map->hash(key);
+	void *data = NULL;
+
+	pthread_mutex_lock(&map->write_lock);
+
+	ConcurrentHashmapTable *table = atomic_load_explicit(&map->table, memory_order_relaxed);
+	ConcurrentHashmapNode *_Atomic *link = ConcurrentHashmap_find_link(map, table, hash, key);
+	ConcurrentHashmapNode *node = atomic_load_explicit(link, memory_order_relaxed);
+
+	if(node != NULL) {
+		// the node keeps its 'next', so readers standing on it can go on
+		atomic_store_explicit(link, atomic_load_explicit(&node->next, memory_order_relaxed), memory_order_release);
+		atomic_fetch_sub_explicit(&map->counter, 1, memory_order_relaxed);
+		data = node->node.data;
+		ConcurrentHashmap_retire_node(map, node);
+	}
+
+	pthread_mutex_unlock(&map->write_lock);
+
+	return data;
+
+error:
+	return NULL;
+}
+
+uint32_t ConcurrentHashmap_count(ConcurrentHashmap *map)
+{
+	return atomic_load_explicit(&map->counter, memory_order_relaxed);
+}
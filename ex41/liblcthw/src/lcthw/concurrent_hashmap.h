@@ -0,0 +1,81 @@
+#ifndef _lcthw_ConcurrentHashmap_h
+#define _lcthw_ConcurrentHashmap_h
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <lcthw/hashmap.h>
+
+#define DEFAULT_NUMBER_OF_CONCURRENT_BUCKETS 128
+
+// retired nodes are reclaimed once there are this many of them
+#define EPOCH_RECLAIM_THRESHOLD 64
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// links memory that is unlinked from the map, but can still be read
+typedef struct EpochRetired {
+	struct EpochRetired *next;
+	uint64_t epoch;
+} EpochRetired;
+
+// nodes are never changed after they are published, set replaces them
+typedef struct ConcurrentHashmapNode {
+	HashmapNode node;
+	struct ConcurrentHashmapNode *_Atomic next;
+	EpochRetired retired;
+} ConcurrentHashmapNode;
+
+typedef struct ConcurrentHashmapTable {
+	EpochRetired retired;
+	uint32_t buckets_number;	// power of two
+	ConcurrentHashmapNode *_Atomic buckets[];
+} ConcurrentHashmapTable;
+
+/*
+ * Thread safe Hashmap where get and traverse take no locks and write
+ * no shared memory. Writers are serialized by 'write_lock', they
+ * publish nodes and bucket tables with atomic stores and free what
+ * they replace only after every reader that could have seen it is
+ * gone (epoch based reclamation). Readers only write their own epoch
+ * slot, which is on its own cache line.
+ */
+typedef struct ConcurrentHashmap {
+	ConcurrentHashmapTable *_Atomic table;
+	Hashmap_compare compare;
+	Hashmap_hash hash;
+	// written by writers only, kept away from what readers read
+	pthread_mutex_t write_lock __attribute__((aligned(CACHE_LINE_SIZE)));
+	_Atomic uint32_t counter;
+	uint32_t retired_number;
+	uint32_t reclaim_at;
+	EpochRetired *retired_nodes;
+	EpochRetired *retired_tables;
+} ConcurrentHashmap;
+
+// 'buckets_number' is rounded up to a power of two, 0 means DEFAULT_NUMBER_OF_CONCURRENT_BUCKETS
+ConcurrentHashmap *ConcurrentHashmap_create(Hashmap_compare compare, Hashmap_hash hash, uint32_t buckets_number);
+
+// no other thread may use the map any more
+void ConcurrentHashmap_destroy(ConcurrentHashmap *map);
+
+/*
+ * The map doesn't own keys and data: data replaced by set or returned
+ * by delete can be freed only when no reader may still use it.
+ */
+int ConcurrentHashmap_set(ConcurrentHashmap *map, void *key, void *data);
+void *ConcurrentHashmap_get(ConcurrentHashmap *map, void *key);
+
+// the callback sees a snapshot of every bucket, it may call set or delete
+int ConcurrentHashmap_traverse(ConcurrentHashmap *map, Hashmap_traverse_cb traverse_cb);
+
+void *ConcurrentHashmap_delete(ConcurrentHashmap *map, void *key);
+
+uint32_t ConcurrentHashmap_count(ConcurrentHashmap *map);
+
+// frees the retired memory no reader can see any more
+void ConcurrentHashmap_reclaim(ConcurrentHashmap *map);
+
+#endif
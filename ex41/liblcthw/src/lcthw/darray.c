@@ -1,6 +1,8 @@
 #include <lcthw/darray.h>
 #include <lcthw/darray_algos.h>
 #include <assert.h>
+#include <limits.h>
+#include <string.h>
 
 DArray *DArray_create(size_t element_size, size_t initial_max)
 {
@@ -45,19 +47,25 @@ error:
 	return -1;
 }
 
+// new slots are zeroed, DArray_clear and the hashmap buckets rely on it
 static inline int DArray_resize(DArray *array, size_t newsize)
 {
 	check(array, "array can't be NULL");
+	check(newsize > 0, "The new size must be > 0.");
+	check(newsize <= INT_MAX, "The new size is too big: %zu", newsize);
 
-	array->max = newsize;
-	check(array->max > 0, "The new size must be > 0.");
-
-	void *contents = realloc(array->contents, array->max * sizeof(void *));
+	void *contents = realloc(array->contents, newsize * sizeof(void *));
 	// check contents and assume realloc doesn't harm the original on error
 	check_mem(contents);
-	
+
 	array->contents = contents;
 
+	if(newsize > (size_t)array->max) {
+		memset(array->contents + array->max, 0, (newsize - array->max) * sizeof(void *));
+	}
+
+	array->max = newsize;
+
 	return 0;
 error:
 	return -1;
@@ -67,12 +75,19 @@ int DArray_expand(DArray *array)
 {
 	check(array, "array can't be NULL");
 
-	size_t old_max = array->max;
-	check(DArray_resize(array, array->max + array->expand_rate) == 0,
-			"Failed to expand array to new size: %d",
-			array->max + (int)array->expand_rate);
+	size_t new_max = (size_t)array->max * DARRAY_GROWTH_FACTOR;
+	if(new_max < array->max + array->expand_rate) {
+		new_max = array->max + array->expand_rate;
+	}
+
+	// the last step may be short of the factor
+	if(new_max > INT_MAX && array->max < INT_MAX) {
+		new_max = INT_MAX;
+	}
+
+	check(DArray_resize(array, new_max) == 0,
+			"Failed to expand array to new size: %zu", new_max);
 
-	memset(array->contents + old_max, 0, array->expand_rate * sizeof(void *));
 	return 0;
 error:
 	return -1;
@@ -89,6 +104,29 @@ error:
 	return -1;
 }
 
+int DArray_reserve(DArray *array, int count)
+{
+	check(array, "array can't be NULL");
+	check(count >= 0, "Wrong count to reserve: %d", count);
+
+	if(count > array->max) {
+		return DArray_resize(array, count);
+	}
+
+	return 0;
+error:
+	return -1;
+}
+
+int DArray_shrink_to_fit(DArray *array)
+{
+	check(array, "array can't be NULL");
+
+	return DArray_resize(array, array->end > 0 ? array->end : 1);
+error:
+	return -1;
+}
+
 void DArray_destroy(DArray *array)
 {
 	if(array) {
@@ -107,14 +145,15 @@ int DArray_push(DArray *array, void *el)
 {
 	check(array, "array can't be NULL");
 
+	// grow only when full, a reserved array takes all its pushes
+	if(DArray_end(array) >= DArray_max(array)) {
+		check(DArray_expand(array) == 0, "Failed to expand for push.");
+	}
+
 	array->contents[array->end] = el;
 	array->end++;
 
-	if(DArray_end(array) >= DArray_max(array)) {
-		return DArray_expand(array);
-	} else {
-		return 0;
-	}
+	return 0;
 error:
 	return -1;
 }
@@ -127,8 +166,10 @@ void *DArray_pop(DArray *array)
 	void *el = DArray_remove(array, array->end - 1);
 	array->end--;
 
-	if(DArray_end(array) > (int)array->expand_rate && DArray_end(array) % array->expand_rate) {
-		DArray_contract(array);
+	// a quarter full gives back half, there is room for as many pushes again
+	if(DArray_end(array) < DArray_max(array) / DARRAY_SHRINK_FACTOR &&
+			DArray_max(array) / 2 > (int)array->expand_rate) {
+		DArray_resize(array, DArray_max(array) / 2);
 	}
 
 	return el;
@@ -140,11 +181,26 @@ int DArray_sort_add(DArray *array, void *el, DArray_compare cmp)
 {
 	check(array, "array can't be NULL");
 
+	// the array is sorted already, only 'el' has to find its place
+	int low = 0;
+	int high = DArray_end(array);
+	int middle = 0;
+
+	while(low < high) {
+		middle = low + (high - low) / 2;
+
+		if(cmp(&el, &array->contents[middle]) < 0) {
+			high = middle;
+		} else {
+			low = middle + 1;
+		}
+	}
+
 	int rc = DArray_push(array, el);
 	check(rc == 0, "push failed");
 
-	rc = DArray_quicksort(array, cmp);
-	check(rc == 0, "sort failed");
+	memmove(array->contents + low + 1, array->contents + low, (DArray_end(array) - 1 - low) * sizeof(void *));
+	array->contents[low] = el;
 
 	return 0;
 error:
@@ -4,6 +4,12 @@
 #include <assert.h>
 #include <lcthw/dbg.h>
 
+/*
+ * 'max' grows by DARRAY_GROWTH_FACTOR and at least by 'expand_rate'
+ * slots, so a push is amortized O(1). Pop gives memory back once the
+ * array is a DARRAY_SHRINK_FACTOR part full, halving 'max', so pushes
+ * and pops around one size never realloc back and forth.
+ */
 typedef struct DArray {
 	int end;
 	int max;
@@ -22,6 +28,12 @@ int DArray_expand(DArray *array);
 
 int DArray_contract(DArray *array);
 
+// makes room for 'count' elements, so pushes up to there never realloc
+int DArray_reserve(DArray *array, int count);
+
+// gives back everything past the elements, unlike contract ignores expand_rate
+int DArray_shrink_to_fit(DArray *array);
+
 int DArray_push(DArray *array, void *el);
 
 void *DArray_pop(DArray *array);
@@ -35,6 +47,8 @@ void DArray_clear_destroy(DArray *array);
 #define DArray_max(A) ((A)->max)
 
 #define DEFAULT_EXPAND_RATE 300
+#define DARRAY_GROWTH_FACTOR 2
+#define DARRAY_SHRINK_FACTOR 4
 
 static inline void DArray_set(DArray *array, int i, void *el)
 {
@@ -1,5 +1,9 @@
 #include <lcthw/darray_algos.h>
+#include <lcthw/darray_sort.h>
+#include <lcthw/bstrlib.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <lcthw/dbg.h>
 
 int DArray_qsort(DArray *array, DArray_compare cmp)
@@ -8,55 +12,74 @@ int DArray_qsort(DArray *array, DArray_compare cmp)
 	return 0;
 }
 
-static inline int get_parent_index(int child_index)
+// 'order' 1 keeps the first element in cmp order on top, -1 the last
+static inline int DArray_heap_above(void *a, void *b, int order, DArray_compare cmp)
 {
-	check(child_index > 0, "'child_index' can't be '0' because it's root index");
+	int rc = cmp(&a, &b);
 
-	return (child_index % 2) ? (child_index - 1) / 2 : (child_index - 2) / 2;
-error:
-	return -1;
+	return order > 0 ? rc < 0 : rc > 0;
 }
 
-int DArray_heapsort(DArray *array, DArray_compare cmp)
+static inline void DArray_sift_down(void **contents, int root, int n, int order, DArray_compare cmp)
 {
-	check(array, "argument 'array' can't be NULL");
+	void *value = contents[root];
+	int child = 0;
+
+	while((child = 2 * root + 1) < n) {
+		if(child + 1 < n && DArray_heap_above(contents[child + 1], contents[child], order, cmp)) child++;
+		if(!DArray_heap_above(contents[child], value, order, cmp)) break;
 
-	if(DArray_count(array) <= 1) {
-		return 0;
+		contents[root] = contents[child];
+		root = child;
 	}
 
-	int i = 0, j = 0, current_index = 0, parent_index = 0;
-	void *current_value = NULL, *parent_value = NULL, *buf_value = NULL;
+	contents[root] = value;
+}
 
-	for(i = 0; i < DArray_count(array) - 1; i++) {
+static inline void DArray_sift_up(void **contents, int i, int order, DArray_compare cmp)
+{
+	void *value = contents[i];
+	int parent = 0;
 
-		for(j = 1; j < DArray_count(array) - i; j++) {
+	while(i > 0) {
+		parent = (i - 1) / 2;
+		if(!DArray_heap_above(value, contents[parent], order, cmp)) break;
 
-			current_index = j;
-			parent_index = get_parent_index(current_index);
+		contents[i] = contents[parent];
+		i = parent;
+	}
 
-			current_value = DArray_get(array, current_index);
-			parent_value = DArray_get(array, parent_index);
+	contents[i] = value;
+}
 
-			while(cmp(&current_value, &parent_value) > 0) {
+// bottom-up, O(n)
+static inline void DArray_build_heap(void **contents, int n, int order, DArray_compare cmp)
+{
+	int i = 0;
 
-				DArray_set(array, current_index, parent_value);
-				DArray_set(array, parent_index, current_value);
+	for(i = n / 2 - 1; i >= 0; i--) {
+		DArray_sift_down(contents, i, n, order, cmp);
+	}
+}
+
+int DArray_heapsort(DArray *array, DArray_compare cmp)
+{
+	check(array, "argument 'array' can't be NULL");
 
-				// if "root" has been reached
-				if(parent_index == 0) break;
+	int n = DArray_count(array);
+	void **contents = array->contents;
+	void *top = NULL;
+	int i = 0;
 
-				current_index = parent_index;
-				parent_index = get_parent_index(current_index);
+	// the last in order goes on top and is swapped to the end
+	DArray_build_heap(contents, n, -1, cmp);
 
-				current_value = DArray_get(array, current_index);
-				parent_value = DArray_get(array, parent_index);
-			}
-		}
+	for(i = n - 1; i > 0; i--) {
+		top = contents[0];
+		contents[0] = contents[i];
+		contents[i] = top;
 
-		buf_value = DArray_first(array);
-		DArray_set(array, 0, DArray_get(array, j - 1));
-		DArray_set(array, j - 1, buf_value);
+		DArray_sift_down(contents, 0, i, -1, cmp);
 	}
 
 	return 0;
@@ -64,6 +87,47 @@ error:
 	return -1;
 }
 
+int DArray_heapify(DArray *array, DArray_compare cmp)
+{
+	check(array, "argument 'array' can't be NULL");
+
+	DArray_build_heap(array->contents, DArray_count(array), 1, cmp);
+
+	return 0;
+error:
+	return -1;
+}
+
+int DArray_heap_push(DArray *array, void *el, DArray_compare cmp)
+{
+	check(array, "argument 'array' can't be NULL");
+	check(DArray_push(array, el) == 0, "Failed to push to the heap.");
+
+	DArray_sift_up(array->contents, DArray_count(array) - 1, 1, cmp);
+
+	return 0;
+error:
+	return -1;
+}
+
+void *DArray_heap_pop(DArray *array, DArray_compare cmp)
+{
+	check(array, "argument 'array' can't be NULL");
+	check(DArray_count(array) > 0, "Attempt to pop from empty heap.");
+
+	void *top = array->contents[0];
+	void *last = DArray_pop(array);
+
+	if(DArray_count(array) > 0) {
+		array->contents[0] = last;
+		DArray_sift_down(array->contents, 0, DArray_count(array), 1, cmp);
+	}
+
+	return top;
+error:
+	return NULL;
+}
+
 static inline int DArray_merge(DArray *array, int start_left_index, int left_count, int right_count, DArray_compare cmp)
 {
 	check(array, "argument 'array' can't be NULL");
@@ -149,63 +213,80 @@ int DArray_mergesort(DArray *array, DArray_compare cmp)
 	return DArray_mergesort_utility(array, 0, DArray_count(array), cmp);
 }
 
-static inline int DArray_partition(DArray *array, int first_index, int last_index, DArray_compare cmp)
+
+#define DArray_uint32_less(A, B) (*(uint32_t *)(A) < *(uint32_t *)(B))
+#define DArray_uint64_less(A, B) (*(uint64_t *)(A) < *(uint64_t *)(B))
+#define DArray_double_less(A, B) (*(double *)(A) < *(double *)(B))
+
+// byte order, a prefix goes first
+static inline int DArray_bstring_less(const_bstring a, const_bstring b)
 {
-	check(last_index - first_index > 0, "subarray length must be >= 2");
+	int len = a->slen < b->slen ? a->slen : b->slen;
+	int rc = memcmp(a->data, b->data, len);
 
-	int count = last_index - first_index + 1;
+	return rc < 0 || (rc == 0 && a->slen < b->slen);
+}
 
-	int pivot_index = first_index + count / 2;
-	void *pivot_value = DArray_get(array, pivot_index);
+DARRAY_SORT_DEFINE(DArray_introsort_uint32, void *, DArray_uint32_less)
+DARRAY_SORT_DEFINE(DArray_introsort_uint64, void *, DArray_uint64_less)
+DARRAY_SORT_DEFINE(DArray_introsort_double, void *, DArray_double_less)
+DARRAY_SORT_DEFINE(DArray_introsort_bstring, void *, DArray_bstring_less)
 
-	DArray_set(array, pivot_index, DArray_get(array, last_index));
-	DArray_set(array, last_index, pivot_value);
+int DArray_sort_uint32(DArray *array)
+{
+	check(array, "argument 'array' can't be NULL");
 
-	int i = 0;
-	void *i_value = NULL;
-	int new_pivot_index = first_index;
-	
-	for(i = first_index; i < last_index; i++) {
-		i_value = DArray_get(array, i);
+	DArray_introsort_uint32(array->contents, DArray_count(array), NULL);
 
-		if(cmp(&i_value, &pivot_value) < 0) {
-			if(i != new_pivot_index) {
-				DArray_set(array, i, DArray_get(array, new_pivot_index));
-				DArray_set(array, new_pivot_index, i_value);
-			}
-			
-			new_pivot_index++;
-		}
-	}
+	return 0;
+error:
+	return -1;
+}
 
-	void *buf_value = DArray_get(array, new_pivot_index);
-	DArray_set(array, new_pivot_index, DArray_get(array, last_index));
-	DArray_set(array, last_index, buf_value);
+int DArray_sort_uint64(DArray *array)
+{
+	check(array, "argument 'array' can't be NULL");
+
+	DArray_introsort_uint64(array->contents, DArray_count(array), NULL);
 
-	return new_pivot_index;
+	return 0;
 error:
 	return -1;
 }
 
-static int DArray_quicksort_utility(DArray *array, int first_index, int last_index, DArray_compare cmp)
+int DArray_sort_double(DArray *array)
 {
 	check(array, "argument 'array' can't be NULL");
 
-	int new_pivot_index = 0;
+	DArray_introsort_double(array->contents, DArray_count(array), NULL);
 
-	if(first_index < last_index) {
+	return 0;
+error:
+	return -1;
+}
 
-		new_pivot_index = DArray_partition(array, first_index, last_index, cmp);
-		DArray_quicksort_utility(array, first_index, new_pivot_index - 1, cmp);
-		DArray_quicksort_utility(array, new_pivot_index + 1, last_index, cmp);
-	}
+int DArray_sort_bstring(DArray *array)
+{
+	check(array, "argument 'array' can't be NULL");
+
+	DArray_introsort_bstring(array->contents, DArray_count(array), NULL);
 
 	return 0;
 error:
 	return -1;
 }
 
+#define DArray_cmp_less(A, B) (cmp(&(A), &(B)) < 0)
+
+DARRAY_SORT_DEFINE(DArray_introsort, void *, DArray_cmp_less)
+
 int DArray_quicksort(DArray *array, DArray_compare cmp)
 {
-	return DArray_quicksort_utility(array, 0, DArray_count(array) - 1, cmp);
+	check(array, "argument 'array' can't be NULL");
+
+	DArray_introsort(array->contents, DArray_count(array), cmp);
+
+	return 0;
+error:
+	return -1;
 }
@@ -11,6 +11,42 @@ int DArray_heapsort(DArray *array, DArray_compare cmp);
 
 int DArray_mergesort(DArray *array, DArray_compare cmp);
 
+// introsort: O(n log n) worst case, O(log n) stack, no allocation, not stable
 int DArray_quicksort(DArray *array, DArray_compare cmp);
 
+// inserts 'el' at its place in an array sorted with 'cmp', O(log n) compares
+int DArray_sort_add(DArray *array, void *el, DArray_compare cmp);
+
+// index of an element equal to 'to_find' in a sorted array, -1 if none
+int DArray_find(DArray *array, void *to_find, DArray_compare cmp);
+
+/*
+ * Binary heap priority queue on a DArray: the element that comes first
+ * in 'cmp' order is on top. Push and pop are O(log n), heapify turns
+ * any array into a heap in O(n). Every call on one heap must use the
+ * same 'cmp'.
+ */
+int DArray_heapify(DArray *array, DArray_compare cmp);
+int DArray_heap_push(DArray *array, void *el, DArray_compare cmp);
+
+// the top element or NULL when the heap is empty
+void *DArray_heap_pop(DArray *array, DArray_compare cmp);
+
+#define DArray_heap_peek(A) (DArray_count(A) > 0 ? DArray_first(A) : NULL)
+
+/*
+ * Introsorts specialized on the key type, with the comparison inlined
+ * instead of a DArray_compare call per step. The elements point to a
+ * uint32_t, uint64_t or double, or are bstrings. NaNs and NULL or
+ * broken bstrings aren't handled.
+ *
+ * bstrings go in byte order: memcmp, then the shorter one first. That
+ * is bstrcmp order for text, bstrcmp differs on bytes over 127 (it
+ * compares them as char) and stops at a zero byte.
+ */
+int DArray_sort_uint32(DArray *array);
+int DArray_sort_uint64(DArray *array);
+int DArray_sort_double(DArray *array);
+int DArray_sort_bstring(DArray *array);
+
 #endif
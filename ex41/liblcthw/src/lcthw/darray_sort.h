@@ -0,0 +1,152 @@
+#ifndef darray_sort_h
+#define darray_sort_h
+
+#include <lcthw/darray_algos.h>
+
+// shorter ranges are finished with insertion sort
+#define DARRAY_SORT_THRESHOLD 16
+
+// longer ranges take the median of three medians of three as pivot
+#define DARRAY_SORT_NINTHER 128
+
+/*
+ * Generates an introsort for a plain C array of TYPE:
+ *
+ *   static void NAME(TYPE *a, int n, DArray_compare cmp);
+ *
+ * LESS(A, B) is an expression on two TYPE lvalues. It is expanded
+ * inline, so a LESS that doesn't call 'cmp' sorts without a single
+ * indirect call. 'cmp' is passed through for the LESS that do and is
+ * NULL otherwise.
+ *
+ * Quicksort with a median of three pivot (Tukey's ninther on long
+ * ranges) and Hoare partitioning, so runs of equal keys split in the
+ * middle. The smaller side recurses and the larger one loops, so the
+ * stack stays under log2(n) frames. After 2 log2(n) levels without
+ * finishing it switches to heapsort, which makes the worst case
+ * O(n log n). Not stable.
+ */
+#define DARRAY_SORT_DEFINE(NAME, TYPE, LESS)									\
+static inline void NAME##_insertion(TYPE *a, int n, DArray_compare cmp)		\
+{																				\
+	int i = 0;																	\
+	int j = 0;																	\
+	(void)cmp;																	\
+																				\
+	for(i = 1; i < n; i++) {													\
+		TYPE value = a[i];														\
+																				\
+		for(j = i; j > 0 && LESS(value, a[j - 1]); j--) {						\
+			a[j] = a[j - 1];													\
+		}																		\
+		a[j] = value;															\
+	}																			\
+}																				\
+																				\
+static inline void NAME##_sift_down(TYPE *a, int root, int n, DArray_compare cmp)	\
+{																				\
+	TYPE value = a[root];														\
+	int child = 0;																\
+	(void)cmp;																	\
+																				\
+	while((child = 2 * root + 1) < n) {											\
+		if(child + 1 < n && LESS(a[child], a[child + 1])) child++;				\
+		if(!LESS(value, a[child])) break;										\
+																				\
+		a[root] = a[child];														\
+		root = child;															\
+	}																			\
+	a[root] = value;															\
+}																				\
+																				\
+static void NAME##_heapsort(TYPE *a, int n, DArray_compare cmp)				\
+{																				\
+	int i = 0;																	\
+																				\
+	for(i = n / 2 - 1; i >= 0; i--) {											\
+		NAME##_sift_down(a, i, n, cmp);											\
+	}																			\
+																				\
+	for(i = n - 1; i > 0; i--) {												\
+		TYPE top = a[0];														\
+		a[0] = a[i];															\
+		a[i] = top;																\
+		NAME##_sift_down(a, 0, i, cmp);											\
+	}																			\
+}																				\
+																				\
+/* puts the median of a[i], a[j] and a[k] to a[j] */							\
+static inline void NAME##_sort3(TYPE *a, int i, int j, int k, DArray_compare cmp)	\
+{																				\
+	TYPE temp;																	\
+	(void)cmp;																	\
+																				\
+	if(LESS(a[j], a[i])) { temp = a[j]; a[j] = a[i]; a[i] = temp; }			\
+	if(LESS(a[k], a[j])) {														\
+		temp = a[j]; a[j] = a[k]; a[k] = temp;									\
+		if(LESS(a[j], a[i])) { temp = a[j]; a[j] = a[i]; a[i] = temp; }		\
+	}																			\
+}																				\
+																				\
+static void NAME##_introsort(TYPE *a, int n, int depth, DArray_compare cmp)	\
+{																				\
+	TYPE pivot;																	\
+	TYPE temp;																	\
+	int middle = 0;																\
+	int step = 0;																\
+	int i = 0;																	\
+	int j = 0;																	\
+																				\
+	while(n > DARRAY_SORT_THRESHOLD) {											\
+		if(depth-- == 0) {														\
+			NAME##_heapsort(a, n, cmp);											\
+			return;																\
+		}																		\
+																				\
+		middle = (n - 1) / 2;													\
+		if(n > DARRAY_SORT_NINTHER) {											\
+			step = n / 8;														\
+			NAME##_sort3(a, 0, step, 2 * step, cmp);							\
+			NAME##_sort3(a, middle - step, middle, middle + step, cmp);			\
+			NAME##_sort3(a, n - 1 - 2 * step, n - 1 - step, n - 1, cmp);		\
+			NAME##_sort3(a, step, middle, n - 1 - step, cmp);					\
+		} else {																\
+			NAME##_sort3(a, 0, middle, n - 1, cmp);								\
+		}																		\
+		pivot = a[middle];														\
+																				\
+		i = -1;																	\
+		j = n;																	\
+		for(;;) {																\
+			do i++; while(LESS(a[i], pivot));									\
+			do j--; while(LESS(pivot, a[j]));									\
+			if(i >= j) break;													\
+																				\
+			temp = a[i]; a[i] = a[j]; a[j] = temp;								\
+		}																		\
+																				\
+		/* [0, j] and [j + 1, n) */												\
+		if(j + 1 < n - j - 1) {													\
+			NAME##_introsort(a, j + 1, depth, cmp);								\
+			a += j + 1;															\
+			n -= j + 1;															\
+		} else {																\
+			NAME##_introsort(a + j + 1, n - j - 1, depth, cmp);					\
+			n = j + 1;															\
+		}																		\
+	}																			\
+																				\
+	NAME##_insertion(a, n, cmp);												\
+}																				\
+																				\
+static void NAME(TYPE *a, int n, DArray_compare cmp)							\
+{																				\
+	int depth = 0;																\
+	int size = 0;																\
+																				\
+	for(size = n; size > 1; size >>= 1) depth += 2;								\
+																				\
+	NAME##_introsort(a, n, depth, cmp);											\
+}
+
+#endif
@@ -0,0 +1,236 @@
+#include <lcthw/darrayv.h>
+#include <lcthw/darray_sort.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+DArrayV *DArrayV_create(size_t element_size, size_t initial_max)
+{
+	DArrayV *array = malloc(sizeof(DArrayV));
+	check_mem(array);
+
+	array->contents = NULL;
+	array->max = initial_max;
+	check(array->max > 0, "You must set an initial_max > 0.");
+
+	array->element_size = element_size;
+	check(array->element_size > 0, "You must set an element_size > 0.");
+
+	array->contents = malloc(initial_max * element_size);
+	check_mem(array->contents);
+
+	array->end = 0;
+	array->expand_rate = DEFAULT_EXPAND_RATE;
+
+	return array;
+
+error:
+	if(array) free(array);
+	return NULL;
+}
+
+void DArrayV_destroy(DArrayV *array)
+{
+	if(array) {
+		if(array->contents) free(array->contents);
+		free(array);
+	}
+}
+
+static inline int DArrayV_resize(DArrayV *array, size_t newsize)
+{
+	check(array, "array can't be NULL");
+	check(newsize > 0, "The new size must be > 0.");
+	check(newsize <= INT_MAX, "The new size is too big: %zu", newsize);
+
+	void *contents = realloc(array->contents, newsize * array->element_size);
+	// check contents and assume realloc doesn't harm the original on error
+	check_mem(contents);
+
+	array->contents = contents;
+	array->max = newsize;
+
+	return 0;
+error:
+	return -1;
+}
+
+int DArrayV_expand(DArrayV *array)
+{
+	check(array, "array can't be NULL");
+
+	size_t new_max = (size_t)array->max * DARRAY_GROWTH_FACTOR;
+	if(new_max < array->max + array->expand_rate) {
+		new_max = array->max + array->expand_rate;
+	}
+
+	if(new_max > INT_MAX && array->max < INT_MAX) {
+		new_max = INT_MAX;
+	}
+
+	check(DArrayV_resize(array, new_max) == 0,
+			"Failed to expand array to new size: %zu", new_max);
+
+	return 0;
+error:
+	return -1;
+}
+
+int DArrayV_reserve(DArrayV *array, int count)
+{
+	check(array, "array can't be NULL");
+	check(count >= 0, "Wrong count to reserve: %d", count);
+
+	if(count > array->max) {
+		return DArrayV_resize(array, count);
+	}
+
+	return 0;
+error:
+	return -1;
+}
+
+int DArrayV_shrink_to_fit(DArrayV *array)
+{
+	check(array, "array can't be NULL");
+
+	return DArrayV_resize(array, array->end > 0 ? array->end : 1);
+error:
+	return -1;
+}
+
+void *DArrayV_new(DArrayV *array)
+{
+	check(array, "array can't be NULL");
+
+	if(DArrayV_end(array) >= DArrayV_max(array)) {
+		check(DArrayV_expand(array) == 0, "Failed to expand for push.");
+	}
+
+	void *el = array->contents + array->end * array->element_size;
+	memset(el, 0, array->element_size);
+	array->end++;
+
+	return el;
+error:
+	return NULL;
+}
+
+int DArrayV_push(DArrayV *array, const void *el)
+{
+	check(array, "array can't be NULL");
+
+	if(DArrayV_end(array) >= DArrayV_max(array)) {
+		check(DArrayV_expand(array) == 0, "Failed to expand for push.");
+	}
+
+	memcpy(array->contents + array->end * array->element_size, el, array->element_size);
+	array->end++;
+
+	return 0;
+error:
+	return -1;
+}
+
+int DArrayV_pop(DArrayV *array, void *el)
+{
+	check(array, "array can't be NULL");
+	check(array->end - 1 >= 0, "Attempt to pop from empty array.");
+
+	array->end--;
+
+	if(el) {
+		memcpy(el, array->contents + array->end * array->element_size, array->element_size);
+	}
+
+	if(DArrayV_end(array) < DArrayV_max(array) / DARRAY_SHRINK_FACTOR &&
+			DArrayV_max(array) / 2 > (int)array->expand_rate) {
+		DArrayV_resize(array, DArrayV_max(array) / 2);
+	}
+
+	return 0;
+error:
+	return -1;
+}
+
+int DArrayV_sort(DArrayV *array, DArrayV_compare cmp)
+{
+	check(array, "array can't be NULL");
+
+	qsort(array->contents, DArrayV_count(array), array->element_size, cmp);
+
+	return 0;
+error:
+	return -1;
+}
+
+#define DArrayV_value_less(A, B) ((A) < (B))
+
+DARRAY_SORT_DEFINE(DArrayV_introsort_uint32, uint32_t, DArrayV_value_less)
+DARRAY_SORT_DEFINE(DArrayV_introsort_uint64, uint64_t, DArrayV_value_less)
+DARRAY_SORT_DEFINE(DArrayV_introsort_double, double, DArrayV_value_less)
+
+int DArrayV_sort_uint32(DArrayV *array)
+{
+	check(array, "array can't be NULL");
+	check(array->element_size == sizeof(uint32_t), "Elements aren't uint32_t.");
+
+	DArrayV_introsort_uint32((uint32_t *)array->contents, DArrayV_count(array), NULL);
+
+	return 0;
+error:
+	return -1;
+}
+
+int DArrayV_sort_uint64(DArrayV *array)
+{
+	check(array, "array can't be NULL");
+	check(array->element_size == sizeof(uint64_t), "Elements aren't uint64_t.");
+
+	DArrayV_introsort_uint64((uint64_t *)array->contents, DArrayV_count(array), NULL);
+
+	return 0;
+error:
+	return -1;
+}
+
+int DArrayV_sort_double(DArrayV *array)
+{
+	check(array, "array can't be NULL");
+	check(array->element_size == sizeof(double), "Elements aren't double.");
+
+	DArrayV_introsort_double((double *)array->contents, DArrayV_count(array), NULL);
+
+	return 0;
+error:
+	return -1;
+}
+
+int DArrayV_find(DArrayV *array, const void *key, DArrayV_compare cmp)
+{
+	check(array, "array can't be NULL");
+
+	int low = 0;
+	int high = DArrayV_end(array) - 1;
+
+	int middle = 0;
+	int cmp_result = 0;
+
+	while(low <= high) {
+		middle = low + (high - low) / 2;
+
+		cmp_result = cmp(key, array->contents + middle * array->element_size);
+
+		if(cmp_result < 0) {
+			high = middle - 1;
+		} else if(cmp_result > 0) {
+			low = middle + 1;
+		} else {
+			return middle;
+		}
+	}
+
+	return -1;
+error:
+	return -2;
+}
@@ -0,0 +1,90 @@
+#ifndef _DArrayV_h
+#define _DArrayV_h
+#include <stdlib.h>
+#include <string.h>
+#include <lcthw/dbg.h>
+#include <lcthw/darray.h>
+
+/*
+ * DArray that stores the elements by value: 'contents' holds 'max'
+ * elements of 'element_size' bytes back to back, so there is no
+ * allocation per element and a scan streams through memory. Push and
+ * pop copy elements in and out. Pointers from DArrayV_get and
+ * DArrayV_new are good until the next push, pop or resize.
+ *
+ * Grows and shrinks like DArray.
+ */
+typedef struct DArrayV {
+	int end;
+	int max;
+	size_t element_size;
+	size_t expand_rate;
+	char *contents;
+} DArrayV;
+
+// qsort style, 'a' and 'b' point to the elements
+typedef int (*DArrayV_compare)(const void *a, const void *b);
+
+DArrayV *DArrayV_create(size_t element_size, size_t initial_max);
+
+void DArrayV_destroy(DArrayV *array);
+
+int DArrayV_expand(DArrayV *array);
+
+// makes room for 'count' elements, so pushes up to there never realloc
+int DArrayV_reserve(DArrayV *array, int count);
+
+int DArrayV_shrink_to_fit(DArrayV *array);
+
+// copies 'element_size' bytes from 'el' to the end
+int DArrayV_push(DArrayV *array, const void *el);
+
+// appends a zeroed element and returns it to be filled in place
+void *DArrayV_new(DArrayV *array);
+
+// copies the last element to 'el' (when not NULL) and removes it
+int DArrayV_pop(DArrayV *array, void *el);
+
+int DArrayV_sort(DArrayV *array, DArrayV_compare cmp);
+
+// introsorts of arrays of plain uint32_t, uint64_t or double, no callback at all
+int DArrayV_sort_uint32(DArrayV *array);
+int DArrayV_sort_uint64(DArrayV *array);
+int DArrayV_sort_double(DArrayV *array);
+
+// index of an element equal to 'key' in a sorted array, -1 if none
+int DArrayV_find(DArrayV *array, const void *key, DArrayV_compare cmp);
+
+#define DArrayV_end(A) ((A)->end)
+#define DArrayV_count(A) DArrayV_end(A)
+#define DArrayV_max(A) ((A)->max)
+
+// unchecked typed access, the element type must be 'element_size' long
+#define DArrayV_at(A, T, I) (((T *)(A)->contents)[(I)])
+
+#define DArrayV_first(A) ((void *)(A)->contents)
+#define DArrayV_last(A) ((void *)((A)->contents + ((A)->end - 1) * (A)->element_size))
+
+static inline void *DArrayV_get(DArrayV *array, int i)
+{
+	check(array, "array can't be NULL");
+	check(i < array->end, "darrayv attempt to get past end");
+	check(i >= 0, "index 'i' can't be negative");
+
+	return array->contents + i * array->element_size;
+error:
+	return NULL;
+}
+
+static inline void DArrayV_set(DArrayV *array, int i, const void *el)
+{
+	check(array, "array can't be NULL");
+	check(i < array->end, "darrayv attempt to set past end");
+	check(i >= 0, "index 'i' can't be negative");
+
+	memcpy(array->contents + i * array->element_size, el, array->element_size);
+error:
+	return;
+}
+
+#endif
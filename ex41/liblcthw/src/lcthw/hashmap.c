@@ -5,33 +5,99 @@
 #include <lcthw/bstrlib.h>
 #include <lcthw/darray_algos.h>
 #include <lcthw/hashmap_algos.h>
+#include <sys/random.h>
+#include <time.h>
+
+#ifdef HASHMAP_COUNT_COMPARES
+// relaxed atomic, readers of a ShardedHashmap shard count under a shared lock
+#define HASHMAP_COUNT(M, F) __atomic_fetch_add(&(M)->F, 1, __ATOMIC_RELAXED)
+#else
+#define HASHMAP_COUNT(M, F)
+#endif
 
 static int default_compare(void **a, void **b) 
 {
 	return bstrcmp((bstring)((HashmapNode *)*a)->key, (bstring)((HashmapNode *)*b)->key);
 }
 
-Hashmap *Hashmap_create_advanced(Hashmap_compare compare, Hashmap_hash hash, uint32_t buckets_number, uint32_t max_load)
+static inline uint32_t Hashmap_round_up_pow2(uint32_t n)
+{
+	uint32_t result = 1;
+
+	while(result < n) {
+		result <<= 1;
+	}
+
+	return result;
+}
+
+static inline uint64_t Hashmap_splitmix(uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+
+	return x ^ (x >> 31);
+}
+
+void Hashmap_random_seed(uint64_t *seed)
+{
+	struct timespec now;
+
+	// without the entropy pool a seed from the clock and the address is
+	// still different for every map
+	if(getrandom(seed, 2 * sizeof(uint64_t), GRND_NONBLOCK) != 2 * sizeof(uint64_t)) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		seed[0] = Hashmap_splitmix((uint64_t)now.tv_sec * 1000000000 + now.tv_nsec);
+		seed[1] = Hashmap_splitmix(seed[0] ^ (uintptr_t)seed);
+	}
+}
+
+static void Hashmap_set_hash(Hashmap *map, Hashmap_hash hash)
+{
+	if(hash != NULL) {
+		map->hash = hash;
+		return;
+	}
+
+	map->keyed_hash = Hashmap_siphash;
+	Hashmap_random_seed(map->seed);
+}
+
+static inline uint32_t Hashmap_hash_key(Hashmap *map, void *key)
+{
+	return map->keyed_hash ? map->keyed_hash(key, map->seed) : map->hash(key);
+}
+
+Hashmap *Hashmap_create_advanced(Hashmap_compare compare, Hashmap_hash hash, uint32_t buckets_number, uint32_t max_load, float load_factor)
 {
 	Hashmap *map = calloc(1, sizeof(Hashmap));
 	check_mem(map);
 
-	map->compare = compare == NULL ? default_compare : compare;
-	map->hash = hash == NULL ? default_hash : hash;
+	map->compare = compare == NULL ? (Hashmap_compare)default_compare : compare;
+	Hashmap_set_hash(map, hash);
 
 	map->default_number_of_buckets = (buckets_number == 0) ? DEFAULT_NUMBER_OF_BUCKETS : buckets_number;
-	map->default_max_load = (max_load == 0) ? DEFAULT_MAX_LOAD : max_load;
+	map->default_max_load = max_load;
+
+	if(max_load == 0) {
+		// geometric growth, buckets are picked with a mask
+		check(load_factor >= 0, "load_factor can't be negative.");
+		check(map->default_number_of_buckets <= (1UL << 31), "Too many buckets: %u", buckets_number);
+
+		map->load_factor = (load_factor == 0) ? DEFAULT_LOAD_FACTOR : load_factor;
+		map->default_number_of_buckets = Hashmap_round_up_pow2(map->default_number_of_buckets);
+	}
 
 	map->buckets_number = map->default_number_of_buckets;
 
 	map->buckets = DArray_create(sizeof(DArray *), map->default_number_of_buckets);
+	check_mem(map->buckets);
 	map->buckets->expand_rate = map->default_number_of_buckets;
 	map->buckets->end = map->buckets->max; // fake out expanding it
 
 	map->counter = 0;
 
-	check_mem(map->buckets);
-
 	return map;
 
 error:
@@ -44,30 +110,57 @@ error:
 
 Hashmap *Hashmap_create(Hashmap_compare compare, Hashmap_hash hash)
 {
-	return Hashmap_create_advanced(compare, hash, 0, 0);
+	return Hashmap_create_advanced(compare, hash, 0, 0, 0);
 }
 
-void Hashmap_destroy(Hashmap *map)
+Hashmap *Hashmap_create_pooled(Hashmap_compare compare, Hashmap_hash hash, Pool *pool)
 {
-	int i = 0;
+	check(pool, "pool can't be NULL");
+	check(pool->element_size >= sizeof(HashmapNode), "Pool elements are too small for HashmapNode.");
+
+	Hashmap *map = Hashmap_create(compare, hash);
+	check(map, "Failed to create map.");
 
+	map->pool = pool;
+
+	return map;
+
+error:
+	return NULL;
+}
+
+Hashmap *Hashmap_create_flat(Hashmap_compare compare, Hashmap_hash hash, uint32_t slots_number)
+{
+	Hashmap *map = calloc(1, sizeof(Hashmap));
+	check_mem(map);
+
+	map->engine = HASHMAP_FLAT;
+
+	map->compare = compare == NULL ? (Hashmap_compare)default_compare : compare;
+	Hashmap_set_hash(map, hash);
+
+	check(slots_number <= (1UL << 31), "Too many slots: %u", slots_number);
+	map->default_number_of_buckets = Hashmap_round_up_pow2(slots_number == 0 ? DEFAULT_NUMBER_OF_SLOTS : slots_number);
+	map->buckets_number = map->default_number_of_buckets;
+
+	map->slots = calloc(map->buckets_number, sizeof(HashmapNode));
+	check_mem(map->slots);
+
+	map->counter = 0;
+
+	return map;
+
+error:
 	if(map) {
-		if(map->buckets) {	
-			for(i = 0; i < DArray_count(map->buckets); i++) {
-				DArray *bucket = DArray_get(map->buckets, i);
-				if(bucket) {
-					DArray_clear_destroy(bucket);
-				}
-			}
-			DArray_destroy(map->buckets);
-		}
-		free(map);
+		Hashmap_destroy(map);
 	}
+
+	return NULL;
 }
 
-static inline HashmapNode *Hashmap_node_create(int hash, void *key, void *data)
+static inline HashmapNode *Hashmap_node_create(Hashmap *map, uint32_t hash, void *key, void *data)
 {
-	HashmapNode *node = calloc(1, sizeof(HashmapNode));
+	HashmapNode *node = map->pool ? Pool_alloc(map->pool) : calloc(1, sizeof(HashmapNode));
 	check_mem(node);
 
 	node->key = key;
@@ -80,18 +173,65 @@ error:
 	return NULL;
 }
 
-static inline DArray *Hashmap_find_bucket(Hashmap *map, void *key, int create, uint32_t *hash_out)
+static inline void Hashmap_node_destroy(Hashmap *map, HashmapNode *node)
 {
-	uint32_t hash = map->hash(key);
-	int bucket_n = hash % map->buckets_number;
+	if(map->pool) {
+		Pool_free(map->pool, node);
+	} else {
+		free(node);
+	}
+}
+
+static void Hashmap_buckets_destroy(Hashmap *map, DArray *buckets)
+{
+	int i = 0;
+	int j = 0;
+
+	for(i = 0; i < DArray_count(buckets); i++) {
+		DArray *bucket = DArray_get(buckets, i);
+		if(bucket) {
+			for(j = 0; j < DArray_count(bucket); j++) {
+				Hashmap_node_destroy(map, DArray_get(bucket, j));
+			}
+			DArray_destroy(bucket);
+		}
+	}
+
+	DArray_destroy(buckets);
+}
+
+void Hashmap_destroy(Hashmap *map)
+{
+	if(map) {
+		if(map->buckets) {	
+			Hashmap_buckets_destroy(map, map->buckets);
+		}
+		if(map->old_buckets) {
+			Hashmap_buckets_destroy(map, map->old_buckets);
+		}
+		if(map->slots) {
+			free(map->slots);
+		}
+		free(map);
+	}
+}
+
+static inline uint32_t Hashmap_bucket_n(Hashmap *map, uint32_t hash, uint32_t buckets_number)
+{
+	// power of two tables don't need the division
+	return map->load_factor > 0 ? hash & (buckets_number - 1) : hash % buckets_number;
+}
+
+static inline DArray *Hashmap_bucket_for_hash(Hashmap *map, uint32_t hash, int create)
+{
+	int bucket_n = Hashmap_bucket_n(map, hash, map->buckets_number);
 	check(bucket_n >= 0, "Invalid bucket found: %d", bucket_n);
-	*hash_out = hash; // store it for the return so the caller can use it
 	
 	DArray *bucket = DArray_get(map->buckets, bucket_n);
 	
 	if(!bucket && create) {
 		// new bucket, set it up
-		bucket = DArray_create(sizeof(void *), map->buckets_number);
+		bucket = DArray_create(sizeof(void *), DEFAULT_BUCKET_SIZE);
 		check_mem(bucket);
 		DArray_set(map->buckets, bucket_n, bucket);
 	}
@@ -102,19 +242,53 @@ error:
 	return NULL;
 }
 
+static inline int Hashmap_key_equals(Hashmap *map, void *key, HashmapNode *node)
+{
+	// map->compare works on pointers to nodes, so give it one from the stack
+	HashmapNode probe = {.key = key};
+	HashmapNode *probe_ptr = &probe;
+
+	HASHMAP_COUNT(map, compares);
+
+	return map->compare(&probe_ptr, &node) == 0;
+}
+
+/*
+ * Buckets are kept sorted by node->hash, so the search runs on the
+ * cached hashes and map->compare is called only for the nodes with
+ * the same hash. Returns the index of the first node with a hash not
+ * less than 'hash'.
+ */
+static inline int Hashmap_bucket_lower_bound(DArray *bucket, uint32_t hash)
+{
+	int low = 0;
+	int high = DArray_count(bucket);
+	int middle = 0;
+
+	while(low < high) {
+		middle = low + (high - low) / 2;
+
+		if(((HashmapNode *)bucket->contents[middle])->hash < hash) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
 static inline int Hashmap_get_node(Hashmap *map, uint32_t hash, DArray *bucket, void *key)
 {
-	// create node only for finding purposes
-	HashmapNode *temp = Hashmap_node_create(0, key, NULL);
+	int i = 0;
+	HashmapNode *node = NULL;
 
-	int i = DArray_find(bucket, temp, (DArray_compare)map->compare);
+	for(i = Hashmap_bucket_lower_bound(bucket, hash); i < DArray_count(bucket); i++) {
+		node = bucket->contents[i];
 
-	// don't need it any more
-	free(temp);
+		if(node->hash != hash) break;
 
-	if(i >= 0) {
-		HashmapNode *node = DArray_get(bucket, i);
-		if(node->hash == hash) {			
+		if(Hashmap_key_equals(map, key, node)) {
 			return i;
 		}
 	}
@@ -122,11 +296,53 @@ static inline int Hashmap_get_node(Hashmap *map, uint32_t hash, DArray *bucket,
 	return -1;
 }
 
+static inline int Hashmap_bucket_add(DArray *bucket, HashmapNode *node)
+{
+	int i = Hashmap_bucket_lower_bound(bucket, node->hash);
+	int count = DArray_count(bucket);
+
+	// push may move contents, so shift after it
+	check(DArray_push(bucket, node) == 0, "Failed to push node to bucket.");
+
+	memmove(&bucket->contents[i + 1], &bucket->contents[i], (count - i) * sizeof(void *));
+	bucket->contents[i] = node;
+
+	return 0;
+
+error:
+	return -1;
+}
+
+static inline void Hashmap_bucket_remove(DArray *bucket, int i)
+{
+	memmove(&bucket->contents[i], &bucket->contents[i + 1], (DArray_count(bucket) - i - 1) * sizeof(void *));
+	DArray_pop(bucket);
+}
+
+// removes node 'i' of the bucket 'bucket_n' of 'buckets', returns its data
+static void *Hashmap_bucket_delete(Hashmap *map, DArray *buckets, uint32_t bucket_n, int i)
+{
+	DArray *bucket = DArray_get(buckets, bucket_n);
+	HashmapNode *node = DArray_get(bucket, i);
+	void *data = node->data;
+
+	Hashmap_node_destroy(map, node);
+	Hashmap_bucket_remove(bucket, i);
+
+	map->counter--;
+
+	if(DArray_count(bucket) == 0) {
+		DArray_destroy(bucket);
+		DArray_remove(buckets, bucket_n);
+	}
+
+	return data;
+}
+
 static int Hashmap_move_nodes(Hashmap *map)
 {
 	int i = 0;
 	int j = 0;
-	uint32_t hash = 0;
 
 	for(i = 0; i < DArray_count(map->buckets); i++) {
 		DArray *bucket = DArray_get(map->buckets, i);
@@ -136,35 +352,186 @@ static int Hashmap_move_nodes(Hashmap *map)
 			for(j = 0; j < DArray_count(bucket); j++) {
 				HashmapNode *node = DArray_get(bucket, j);
 
-				DArray *new_bucket = Hashmap_find_bucket(map, node->key, 1, &hash);
+				// the node keeps its hash, keys aren't hashed again
+				DArray *new_bucket = Hashmap_bucket_for_hash(map, node->hash, 1);
 
-				DArray_push(new_bucket, node);
+				Hashmap_bucket_add(new_bucket, node);
 			}
 
 			DArray_destroy(bucket);
 		}
 	}
 
-	for(i = 0; i < DArray_count(map->buckets); i++) {
-		DArray *bucket = DArray_get(map->buckets, i);
-		if(bucket) {
-			DArray_heapsort(bucket, (DArray_compare)map->compare);
-		}
+	return 0;
+}
+
+static int Hashmap_migrate_bucket(Hashmap *map, uint32_t bucket_n)
+{
+	int j = 0;
+
+	DArray *bucket = DArray_remove(map->old_buckets, bucket_n);
+	if(!bucket) return 0;
+
+	for(j = 0; j < DArray_count(bucket); j++) {
+		HashmapNode *node = DArray_get(bucket, j);
+
+		DArray *new_bucket = Hashmap_bucket_for_hash(map, node->hash, 1);
+		check(new_bucket, "Error can't create bucket.");
+
+		check(Hashmap_bucket_add(new_bucket, node) == 0, "Failed to add node to bucket.");
+	}
+
+	DArray_destroy(bucket);
+
+	return 0;
+
+error:
+	return -1;
+}
+
+static inline void Hashmap_rehash_done(Hashmap *map)
+{
+	DArray_destroy(map->old_buckets);
+	map->old_buckets = NULL;
+	map->old_buckets_number = 0;
+	map->rehash_index = 0;
+}
+
+static void Hashmap_rehash_finish(Hashmap *map)
+{
+	if(!map->old_buckets) return;
+
+	for(; map->rehash_index < map->old_buckets_number; map->rehash_index++) {
+		Hashmap_migrate_bucket(map, map->rehash_index);
+	}
+
+	Hashmap_rehash_done(map);
+}
+
+/*
+ * Does a bounded part of the incremental rehash. The old bucket of
+ * 'hash' is always migrated, so the caller can work with the new
+ * buckets only.
+ */
+static inline void Hashmap_rehash_step(Hashmap *map, uint32_t hash)
+{
+	uint32_t budget = map->rehash_budget;
+
+	if(!map->old_buckets) return;
+
+	Hashmap_migrate_bucket(map, Hashmap_bucket_n(map, hash, map->old_buckets_number));
+
+	for(; budget > 0 && map->rehash_index < map->old_buckets_number; budget--) {
+		Hashmap_migrate_bucket(map, map->rehash_index++);
+	}
+
+	if(map->rehash_index >= map->old_buckets_number) {
+		Hashmap_rehash_done(map);
+	}
+}
+
+static int Hashmap_rehash_start(Hashmap *map, uint32_t buckets_number)
+{
+	// the previous rehash didn't keep up, finish it at once
+	Hashmap_rehash_finish(map);
+
+	DArray *buckets = DArray_create(sizeof(DArray *), buckets_number);
+	check_mem(buckets);
+	buckets->expand_rate = map->default_number_of_buckets;
+	buckets->end = buckets->max; // fake out expanding it
+
+	map->old_buckets = map->buckets;
+	map->old_buckets_number = map->buckets_number;
+	map->rehash_index = 0;
+
+	map->buckets = buckets;
+	map->buckets_number = buckets_number;
+
+	// migrate enough buckets per operation to be done before the next
+	// rehash, with geometric growth it's at least an eighth of the
+	// old table's nodes away
+	uint32_t operations = map->default_max_load;
+	if(map->load_factor > 0) {
+		operations = (uint32_t)(map->old_buckets_number * map->load_factor / 8);
+		operations = operations > 0 ? operations : 1;
+	}
+
+	map->rehash_budget = map->old_buckets_number / operations + 1;
+	if(map->rehash_budget < map->rehash_step) {
+		map->rehash_budget = map->rehash_step;
 	}
 
 	return 0;
+
+error:
+	return -1;
+}
+
+int Hashmap_set_rehash_step(Hashmap *map, uint32_t rehash_step)
+{
+	check(map, "map can't be NULL");
+	check(map->engine == HASHMAP_CHAINED, "Incremental rehash needs the chained engine.");
+
+	if(rehash_step == 0) {
+		Hashmap_rehash_finish(map);
+	}
+
+	map->rehash_step = rehash_step;
+
+	return 0;
+
+error:
+	return -1;
+}
+
+static int Hashmap_resize(Hashmap *map, uint32_t buckets_number)
+{
+	check(Hashmap_rehash_start(map, buckets_number) == 0, "Failed to start rehash.");
+
+	if(map->rehash_step == 0) {
+		Hashmap_rehash_finish(map);
+	}
+
+	return 0;
+
+error:
+	return -1;
 }
 
 static inline int Hashmap_rehash(Hashmap *map, int increase_buckets)
 {
 	if(map->counter == 0) return 0;
 
+	if(map->load_factor > 0) {
+		if(increase_buckets && map->counter >= map->buckets_number * map->load_factor) {
+			check(map->buckets_number < (1UL << 31), "Can't grow buckets any more.");
+			check(Hashmap_resize(map, map->buckets_number * 2) == 0, "Failed to grow buckets.");
+		} else if(!increase_buckets && map->buckets_number > map->default_number_of_buckets &&
+				map->counter < map->buckets_number * map->load_factor / 4) {
+			check(Hashmap_resize(map, map->buckets_number / 2) == 0, "Failed to shrink buckets.");
+		} else {
+			return 0;
+		}
+
+		map->rehash_count++;
+		return map->buckets_number;
+	}
+
 	if(map->counter % map->default_max_load == 0) {
 		// increase number of buckets
 		if(increase_buckets) {
+			map->rehash_count++;
+
+			if(map->rehash_step > 0) {
+				check(Hashmap_rehash_start(map, map->buckets_number + map->default_number_of_buckets) == 0,
+						"Failed to start rehash.");
+				return map->buckets_number;
+			}
+
 			map->buckets_number += map->default_number_of_buckets;
 
-			DArray_expand(map->buckets);
+			// exactly the new buckets, DArray_expand would grow geometrically
+			check(DArray_reserve(map->buckets, map->buckets_number) == 0, "Failed to grow buckets.");
 			map->buckets->end = map->buckets->max; // fake out expanding it
 
 			Hashmap_move_nodes(map);
@@ -172,6 +539,14 @@ static inline int Hashmap_rehash(Hashmap *map, int increase_buckets)
 			return map->buckets_number;
 		// decrease number of buckets if it is possible
 		} else if(map->buckets_number > map->default_number_of_buckets) {
+			map->rehash_count++;
+
+			if(map->rehash_step > 0) {
+				check(Hashmap_rehash_start(map, map->buckets_number - map->default_number_of_buckets) == 0,
+						"Failed to start rehash.");
+				return map->buckets_number;
+			}
+
 			map->buckets_number -= map->default_number_of_buckets;
 
 			Hashmap_move_nodes(map);
@@ -183,33 +558,205 @@ static inline int Hashmap_rehash(Hashmap *map, int increase_buckets)
 	}
 
 	return 0;
+
+error:
+	return -1;
 }
 
-int Hashmap_set(Hashmap *map, void *key, void *data)
+/*
+ * Flat engine. Slots are a power of two array of inline nodes probed
+ * linearly with Robin Hood ordering: a node never sits closer to its
+ * home slot than the node it displaced, so a lookup stops as soon as
+ * it meets an empty slot or a node that is closer to home than the key
+ * would be. A slot is empty when its key is NULL. Deletion shifts the
+ * following nodes back, so there are no tombstones.
+ */
+
+static inline uint32_t Hashmap_flat_distance(uint32_t mask, uint32_t hash, uint32_t index)
 {
-	check(map, "map can't be NULL");
-	check(key, "key can't be NULL");
-	check(data, "data can't be NULL");
+	return (index - hash) & mask;
+}
+
+static inline int Hashmap_flat_find(Hashmap *map, void *key, uint32_t hash)
+{
+	uint32_t mask = map->buckets_number - 1;
+	uint32_t index = hash & mask;
+	uint32_t distance = 0;
+	HashmapNode *slot = NULL;
+
+	HASHMAP_COUNT(map, lookups);
+
+	for(distance = 0; ; distance++, index = (index + 1) & mask) {
+		slot = &map->slots[index];
+
+		if(slot->key == NULL || Hashmap_flat_distance(mask, slot->hash, index) < distance) {
+			return -1;
+		}
+
+		if(slot->hash == hash && Hashmap_key_equals(map, key, slot)) {
+			return index;
+		}
+	}
+}
+
+static inline void Hashmap_flat_insert(HashmapNode *slots, uint32_t mask, HashmapNode node)
+{
+	uint32_t index = node.hash & mask;
+	uint32_t distance = 0;
+	uint32_t slot_distance = 0;
+	HashmapNode temp;
+
+	for(distance = 0; ; distance++, index = (index + 1) & mask) {
+		if(slots[index].key == NULL) {
+			slots[index] = node;
+			return;
+		}
+
+		slot_distance = Hashmap_flat_distance(mask, slots[index].hash, index);
+
+		// take the place of the richer node and carry it further
+		if(slot_distance < distance) {
+			temp = slots[index];
+			slots[index] = node;
+			node = temp;
+			distance = slot_distance;
+		}
+	}
+}
+
+static int Hashmap_flat_resize(Hashmap *map, uint32_t slots_number)
+{
+	uint32_t i = 0;
+
+	HashmapNode *slots = calloc(slots_number, sizeof(HashmapNode));
+	check_mem(slots);
+
+	for(i = 0; i < map->buckets_number; i++) {
+		if(map->slots[i].key != NULL) {
+			Hashmap_flat_insert(slots, slots_number - 1, map->slots[i]);
+		}
+	}
+
+	free(map->slots);
+	map->slots = slots;
+	map->buckets_number = slots_number;
+
+	return 0;
+
+error:
+	return -1;
+}
 
-	uint32_t hash = 0;
-	DArray *bucket = Hashmap_find_bucket(map, key, 1, &hash);
+static int Hashmap_flat_set(Hashmap *map, uint32_t hash, void *key, void *data)
+{
+	int i = Hashmap_flat_find(map, key, hash);
+
+	if(i >= 0) {
+		map->slots[i].data = data;
+		return 0;
+	}
+
+	if((uint64_t)(map->counter + 1) * 100 > (uint64_t)map->buckets_number * FLAT_MAX_LOAD_PERCENT) {
+		check(map->buckets_number < (1UL << 31), "Can't grow slots any more.");
+		check(Hashmap_flat_resize(map, map->buckets_number * 2) == 0, "Failed to grow slots.");
+	}
+
+	HashmapNode node = {.key = key, .data = data, .hash = hash};
+	Hashmap_flat_insert(map->slots, map->buckets_number - 1, node);
+
+	map->counter++;
+
+	return 0;
+
+error:
+	return -1;
+}
+
+static inline void *Hashmap_flat_get(Hashmap *map, uint32_t hash, void *key)
+{
+	int i = Hashmap_flat_find(map, key, hash);
+
+	return i >= 0 ? map->slots[i].data : NULL;
+}
+
+static int Hashmap_flat_traverse(Hashmap *map, Hashmap_traverse_cb traverse_cb)
+{
+	uint32_t i = 0;
+	int rc = 0;
+
+	for(i = 0; i < map->buckets_number; i++) {
+		if(map->slots[i].key != NULL) {
+			rc = traverse_cb(&map->slots[i]);
+			if(rc != 0) return rc;
+		}
+	}
+
+	return 0;
+}
+
+static void *Hashmap_flat_remove(Hashmap *map, uint32_t index)
+{
+	uint32_t mask = map->buckets_number - 1;
+	uint32_t next = (index + 1) & mask;
+	void *data = map->slots[index].data;
+
+	// shift back the nodes which are not in their home slot
+	while(map->slots[next].key != NULL && Hashmap_flat_distance(mask, map->slots[next].hash, next) > 0) {
+		map->slots[index] = map->slots[next];
+		index = next;
+		next = (next + 1) & mask;
+	}
+
+	memset(&map->slots[index], 0, sizeof(HashmapNode));
+
+	map->counter--;
+
+	return data;
+}
+
+static void *Hashmap_flat_delete(Hashmap *map, uint32_t hash, void *key)
+{
+	int i = Hashmap_flat_find(map, key, hash);
+	if(i < 0) return NULL;
+
+	void *data = Hashmap_flat_remove(map, i);
+
+	// shrink when less than a quarter of the allowed load is used,
+	// keep the old slots if it fails, they are still valid
+	if(map->buckets_number > map->default_number_of_buckets &&
+			(uint64_t)map->counter * 400 < (uint64_t)map->buckets_number * FLAT_MAX_LOAD_PERCENT) {
+		Hashmap_flat_resize(map, map->buckets_number / 2);
+	}
+
+	return data;
+}
+
+static int Hashmap_chained_set(Hashmap *map, uint32_t hash, void *key, void *data)
+{
+	HASHMAP_COUNT(map, lookups);
+	Hashmap_rehash_step(map, hash);
+
+	DArray *bucket = Hashmap_bucket_for_hash(map, hash, 1);
 	check(bucket, "Error can't create bucket.");
 
 	int i = Hashmap_get_node(map, hash, bucket, key);
 	
 	if(i < 0) {
-		if(Hashmap_rehash(map, 1) > 0) {
+		int rc = Hashmap_rehash(map, 1);
+		check(rc >= 0, "Failed to rehash.");
+
+		if(rc > 0) {
 			// find new bucket
-			bucket = Hashmap_find_bucket(map, key, 1, &hash);
+			bucket = Hashmap_bucket_for_hash(map, hash, 1);
 
 			check(bucket, "Error can't create bucket.");
 		}
 
-		HashmapNode *node = Hashmap_node_create(hash, key, data);
+		HashmapNode *node = Hashmap_node_create(map, hash, key, data);
 		check_mem(node);
 
-		int rc = DArray_sort_add(bucket, node, (DArray_compare)map->compare);
-		check(rc == 0, "DArray_sort_add failed.");
+		rc = Hashmap_bucket_add(bucket, node);
+		check(rc == 0, "Failed to add node to bucket.");
 
 		map->counter++;
 	} else {
@@ -222,10 +769,44 @@ error:
 	return -1;
 }
 
-void *Hashmap_get(Hashmap *map, void *key)
+uint32_t Hashmap_key_hash(Hashmap *map, void *key)
+{
+	return Hashmap_hash_key(map, key);
+}
+
+int Hashmap_set(Hashmap *map, void *key, void *data)
+{
+	check(map, "map can't be NULL");
+	check(key, "key can't be NULL");
+
+	return Hashmap_set_prehashed(map, key, Hashmap_hash_key(map, key), data);
+
+error:
+	return -1;
+}
+
+int Hashmap_set_prehashed(Hashmap *map, void *key, uint32_t hash, void *data)
 {
-	uint32_t hash = 0;
-	DArray *bucket = Hashmap_find_bucket(map, key, 0, &hash);
+	check(map, "map can't be NULL");
+	check(key, "key can't be NULL");
+	check(data, "data can't be NULL");
+
+	if(map->engine == HASHMAP_FLAT) {
+		return Hashmap_flat_set(map, hash, key, data);
+	}
+
+	return Hashmap_chained_set(map, hash, key, data);
+
+error:
+	return -1;
+}
+
+static inline void *Hashmap_chained_get(Hashmap *map, uint32_t hash, void *key)
+{
+	HASHMAP_COUNT(map, lookups);
+	Hashmap_rehash_step(map, hash);
+
+	DArray *bucket = Hashmap_bucket_for_hash(map, hash, 0);
 	if(!bucket) return NULL;
 
 	int i = Hashmap_get_node(map, hash, bucket, key);
@@ -240,14 +821,140 @@ error: // fallthrough
 	return NULL;
 }
 
-int Hashmap_traverse(Hashmap *map, Hashmap_traverse_cb traverse_cb)
+void *Hashmap_get(Hashmap *map, void *key)
+{
+	return Hashmap_get_prehashed(map, key, Hashmap_hash_key(map, key));
+}
+
+void *Hashmap_get_prehashed(Hashmap *map, void *key, uint32_t hash)
+{
+	if(map->engine == HASHMAP_FLAT) {
+		return Hashmap_flat_get(map, hash, key);
+	}
+
+	return Hashmap_chained_get(map, hash, key);
+}
+
+/*
+ * Hashes 'count' keys, none of them NULL, and prefetches the memory their lookup starts
+ * with: the home slot for the flat engine, the bucket pointer and then
+ * the node array of the bucket for the chained one. The loads of the
+ * whole batch are in flight together instead of one after another.
+ */
+static inline void Hashmap_prefetch_batch(Hashmap *map, void **keys, int count, uint32_t *hashes)
+{
+	int i = 0;
+	DArray *bucket = NULL;
+
+	for(i = 0; i < count; i++) {
+		hashes[i] = Hashmap_hash_key(map, keys[i]);
+
+		if(map->engine == HASHMAP_FLAT) {
+			__builtin_prefetch(&map->slots[hashes[i] & (map->buckets_number - 1)]);
+		} else {
+			__builtin_prefetch(&map->buckets->contents[Hashmap_bucket_n(map, hashes[i], map->buckets_number)]);
+		}
+	}
+
+	if(map->engine == HASHMAP_CHAINED) {
+		for(i = 0; i < count; i++) {
+			bucket = Hashmap_bucket_for_hash(map, hashes[i], 0);
+
+			if(bucket) {
+				__builtin_prefetch(bucket->contents);
+				__builtin_prefetch(bucket->contents[0]);
+			}
+		}
+	}
+}
+
+int Hashmap_get_many(Hashmap *map, void **keys, int n, void **out)
+{
+	uint32_t hashes[HASHMAP_PREFETCH_BATCH];
+	int start = 0;
+	int count = 0;
+	int found = 0;
+	int i = 0;
+
+	check(map, "map can't be NULL");
+	check(keys && out, "keys and out can't be NULL");
+
+	for(start = 0; start < n; start += HASHMAP_PREFETCH_BATCH) {
+		count = n - start < HASHMAP_PREFETCH_BATCH ? n - start : HASHMAP_PREFETCH_BATCH;
+
+		// the batch is hashed before the lookups, so check it first
+		for(i = 0; i < count; i++) {
+			check(keys[start + i], "key can't be NULL");
+		}
+
+		Hashmap_prefetch_batch(map, &keys[start], count, hashes);
+
+		for(i = 0; i < count; i++) {
+			if(map->engine == HASHMAP_FLAT) {
+				out[start + i] = Hashmap_flat_get(map, hashes[i], keys[start + i]);
+			} else {
+				out[start + i] = Hashmap_chained_get(map, hashes[i], keys[start + i]);
+			}
+
+			found += out[start + i] != NULL;
+		}
+	}
+
+	return found;
+
+error:
+	return -1;
+}
+
+int Hashmap_set_many(Hashmap *map, void **keys, void **data, int n)
+{
+	uint32_t hashes[HASHMAP_PREFETCH_BATCH];
+	int start = 0;
+	int count = 0;
+	int rc = 0;
+	int i = 0;
+
+	check(map, "map can't be NULL");
+	check(keys && data, "keys and data can't be NULL");
+
+	for(start = 0; start < n; start += HASHMAP_PREFETCH_BATCH) {
+		count = n - start < HASHMAP_PREFETCH_BATCH ? n - start : HASHMAP_PREFETCH_BATCH;
+
+		// the batch is hashed before the sets, so check it first
+		for(i = 0; i < count; i++) {
+			check(keys[start + i], "key can't be NULL");
+			check(data[start + i], "data can't be NULL");
+		}
+
+		// a set may grow the map in the middle of the batch, then the
+		// prefetches are wasted, but the hashes are still right
+		Hashmap_prefetch_batch(map, &keys[start], count, hashes);
+
+		for(i = 0; i < count; i++) {
+			if(map->engine == HASHMAP_FLAT) {
+				rc = Hashmap_flat_set(map, hashes[i], keys[start + i], data[start + i]);
+			} else {
+				rc = Hashmap_chained_set(map, hashes[i], keys[start + i], data[start + i]);
+			}
+
+			check(rc == 0, "Failed to set key %d.", start + i);
+		}
+	}
+
+	return 0;
+
+error:
+	return -1;
+}
+
+static int Hashmap_buckets_traverse(DArray *buckets, Hashmap_traverse_cb traverse_cb)
 {
 	int i = 0;
 	int j = 0;
 	int rc = 0;
 
-	for(i = 0; i < DArray_count(map->buckets); i++) {
-		DArray *bucket = DArray_get(map->buckets, i);
+	for(i = 0; i < DArray_count(buckets); i++) {
+		DArray *bucket = DArray_get(buckets, i);
 		if(bucket) {
 			for(j = 0; j < DArray_count(bucket); j++) {
 				HashmapNode *node = DArray_get(bucket, j);
@@ -260,35 +967,243 @@ int Hashmap_traverse(Hashmap *map, Hashmap_traverse_cb traverse_cb)
 	return 0;
 }
 
+int Hashmap_traverse(Hashmap *map, Hashmap_traverse_cb traverse_cb)
+{
+	int rc = 0;
+
+	if(map->engine == HASHMAP_FLAT) {
+		return Hashmap_flat_traverse(map, traverse_cb);
+	}
+
+	if(map->old_buckets) {
+		rc = Hashmap_buckets_traverse(map->old_buckets, traverse_cb);
+		if(rc != 0) return rc;
+	}
+
+	return Hashmap_buckets_traverse(map->buckets, traverse_cb);
+}
+
 void *Hashmap_delete(Hashmap *map, void *key)
 {
-	uint32_t hash = 0;
-	DArray *bucket = Hashmap_find_bucket(map, key, 0, &hash);
+	return Hashmap_delete_prehashed(map, key, Hashmap_hash_key(map, key));
+}
+
+void *Hashmap_delete_prehashed(Hashmap *map, void *key, uint32_t hash)
+{
+	if(map->engine == HASHMAP_FLAT) {
+		return Hashmap_flat_delete(map, hash, key);
+	}
+
+	HASHMAP_COUNT(map, lookups);
+	Hashmap_rehash_step(map, hash);
+
+	DArray *bucket = Hashmap_bucket_for_hash(map, hash, 0);
 	if(!bucket) return NULL;
 
 	int i = Hashmap_get_node(map, hash, bucket, key);
 	if(i == -1) return NULL;
 
-	HashmapNode *node = DArray_get(bucket, i);
-	void *data = node->data;
+	void *data = Hashmap_bucket_delete(map, map->buckets, Hashmap_bucket_n(map, hash, map->buckets_number), i);
 	
-	if(DArray_count(bucket) != 1) {
-		DArray_set(bucket, i, DArray_last(bucket));
+	check(Hashmap_rehash(map, 0) >= 0, "Failed to rehash.");
+
+	return data;
+error:
+	// the node is gone either way, so the caller still gets its data back
+	return data;
+}
+
+void Hashmap_iter_init(Hashmap *map, HashmapIter *iter)
+{
+	memset(iter, 0, sizeof(HashmapIter));
+	iter->map = map;
+	iter->index = -1;
+
+	if(map->engine == HASHMAP_FLAT) {
+		// removing a node shifts back the nodes after it up to an empty
+		// slot, starting after one keeps the shifts out of visited slots
+		while(iter->start < map->buckets_number && map->slots[iter->start].key != NULL) {
+			iter->start++;
+		}
+		iter->start = (iter->start + 1) & (map->buckets_number - 1);
+	} else {
+		// a rehash in progress has nodes in both tables
+		iter->buckets = map->old_buckets ? map->old_buckets : map->buckets;
 	}
+}
 
-	DArray_free(node);
-	DArray_pop(bucket);
+static HashmapNode *Hashmap_flat_iter_next(HashmapIter *iter)
+{
+	Hashmap *map = iter->map;
+	HashmapNode *slot = NULL;
 
-	map->counter--;
+	for(; (uint32_t)iter->index < map->buckets_number; iter->index++) {
+		slot = &map->slots[(iter->start + iter->index) & (map->buckets_number - 1)];
 
-	DArray_heapsort(bucket, (DArray_compare)map->compare);
+		if(slot->key != NULL) {
+			return iter->current = slot;
+		}
+	}
 
-	if(DArray_count(bucket) == 0) {
-		DArray_destroy(bucket);
-		DArray_remove(map->buckets, hash % map->buckets_number);
+	return iter->current = NULL;
+}
+
+HashmapNode *Hashmap_iter_next(HashmapIter *iter)
+{
+	DArray *bucket = NULL;
+
+	// the node after a removed one takes its place
+	if(!iter->removed) iter->index++;
+	iter->removed = 0;
+
+	if(iter->map->engine == HASHMAP_FLAT) {
+		return Hashmap_flat_iter_next(iter);
 	}
-	
-	Hashmap_rehash(map, 0);
+
+	while(iter->buckets != NULL) {
+		for(; iter->bucket < (uint32_t)DArray_count(iter->buckets); iter->bucket++, iter->index = 0) {
+			bucket = DArray_get(iter->buckets, iter->bucket);
+
+			if(bucket && iter->index < DArray_count(bucket)) {
+				return iter->current = bucket->contents[iter->index];
+			}
+		}
+
+		iter->buckets = iter->buckets == iter->map->old_buckets ? iter->map->buckets : NULL;
+		iter->bucket = 0;
+		iter->index = 0;
+	}
+
+	return iter->current = NULL;
+}
+
+void *Hashmap_iter_remove_current(HashmapIter *iter)
+{
+	void *data = NULL;
+
+	check(iter->current && !iter->removed, "No current node to remove.");
+
+	// no shrinking here, it would reorder the nodes under the iterator
+	if(iter->map->engine == HASHMAP_FLAT) {
+		data = Hashmap_flat_remove(iter->map, (iter->start + iter->index) & (iter->map->buckets_number - 1));
+	} else {
+		data = Hashmap_bucket_delete(iter->map, iter->buckets, iter->bucket, iter->index);
+	}
+
+	iter->current = NULL;
+	iter->removed = 1;
 
 	return data;
+
+error:
+	return NULL;
+}
+
+int Hashmap_traverse_ctx(Hashmap *map, Hashmap_traverse_ctx_cb traverse_cb, void *ctx)
+{
+	HashmapIter iter;
+	HashmapNode *node = NULL;
+	int rc = 0;
+
+	check(map, "map can't be NULL");
+
+	Hashmap_iter_init(map, &iter);
+
+	while((node = Hashmap_iter_next(&iter)) != NULL) {
+		rc = traverse_cb(node, ctx);
+		if(rc != 0) return rc;
+	}
+
+	return 0;
+
+error:
+	return -1;
+}
+
+static inline void Hashmap_stats_add(HashmapStats *stats, uint32_t length)
+{
+	stats->histogram[length < HASHMAP_STATS_HISTOGRAM ? length : HASHMAP_STATS_HISTOGRAM - 1]++;
+
+	if(length > stats->longest) {
+		stats->longest = length;
+	}
+}
+
+static void Hashmap_buckets_stats(DArray *buckets, HashmapStats *stats)
+{
+	int i = 0;
+	int j = 0;
+	int low = 0;
+	int probes = 0;
+	uint64_t total_probes = 0;
+	DArray *bucket = NULL;
+
+	stats->table_bytes += sizeof(DArray) + DArray_max(buckets) * sizeof(void *);
+
+	for(i = 0; i < DArray_count(buckets); i++) {
+		bucket = DArray_get(buckets, i);
+		stats->buckets++;
+
+		if(!bucket) {
+			Hashmap_stats_add(stats, 0);
+			continue;
+		}
+
+		stats->used_buckets++;
+		stats->bucket_bytes += sizeof(DArray) + DArray_max(bucket) * sizeof(void *);
+		Hashmap_stats_add(stats, DArray_count(bucket));
+
+		// a get does the binary search and then walks the equal hashes
+		for(probes = 1; (1 << probes) <= DArray_count(bucket); probes++);
+
+		for(j = 0; j < DArray_count(bucket); j++) {
+			low = Hashmap_bucket_lower_bound(bucket, ((HashmapNode *)bucket->contents[j])->hash);
+			total_probes += probes + j - low + 1;
+		}
+	}
+
+	stats->average_probes += total_probes;
+}
+
+int Hashmap_stats(Hashmap *map, HashmapStats *stats)
+{
+	uint32_t i = 0;
+	uint32_t distance = 0;
+
+	check(map, "map can't be NULL");
+	check(stats, "stats can't be NULL");
+
+	memset(stats, 0, sizeof(HashmapStats));
+
+	if(map->engine == HASHMAP_FLAT) {
+		stats->buckets = map->buckets_number;
+		stats->table_bytes = map->buckets_number * sizeof(HashmapNode);
+
+		for(i = 0; i < map->buckets_number; i++) {
+			if(map->slots[i].key != NULL) {
+				distance = Hashmap_flat_distance(map->buckets_number - 1, map->slots[i].hash, i);
+				stats->used_buckets++;
+				stats->average_probes += distance + 1;
+				Hashmap_stats_add(stats, distance);
+			}
+		}
+	} else {
+		if(map->old_buckets) {
+			Hashmap_buckets_stats(map->old_buckets, stats);
+		}
+		Hashmap_buckets_stats(map->buckets, stats);
+
+		stats->node_bytes = (size_t)map->counter * (map->pool ? map->pool->element_size : sizeof(HashmapNode));
+	}
+
+	stats->nodes = map->counter;
+	stats->average_probes = map->counter > 0 ? stats->average_probes / map->counter : 0;
+	stats->rehash_count = map->rehash_count;
+	stats->lookups = __atomic_load_n(&map->lookups, __ATOMIC_RELAXED);
+	stats->compares = __atomic_load_n(&map->compares, __ATOMIC_RELAXED);
+
+	return 0;
+
+error:
+	return -1;
 }
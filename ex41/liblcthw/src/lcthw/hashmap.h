@@ -3,41 +3,217 @@
 
 #include <stdint.h>
 #include <lcthw/darray.h>
+#include <lcthw/pool.h>
 
 #define DEFAULT_NUMBER_OF_BUCKETS 100UL
 
-#define DEFAULT_MAX_LOAD 1000000UL
+#define DEFAULT_LOAD_FACTOR 1.0f
 
+#define DEFAULT_BUCKET_SIZE 4
+
+// flat engine grows when more than FLAT_MAX_LOAD_PERCENT of the slots are used
+#define DEFAULT_NUMBER_OF_SLOTS 16UL
+#define FLAT_MAX_LOAD_PERCENT 80
+
+// keys hashed and prefetched ahead by Hashmap_get_many and Hashmap_set_many
+#define HASHMAP_PREFETCH_BATCH 16
+
+// the last histogram entry counts everything from HASHMAP_STATS_HISTOGRAM - 1 up
+#define HASHMAP_STATS_HISTOGRAM 8
+
+// gets two (HashmapNode **) and returns 0 when their keys are equal,
+// it's called only for nodes with the same hash
 typedef int (*Hashmap_compare)(void *a, void *b);
 typedef uint32_t (*Hashmap_hash)(void *key);
+// 'seed' points to the two words of Hashmap 'seed'
+typedef uint32_t (*Hashmap_keyed_hash)(void *key, const uint64_t *seed);
+
+typedef enum HashmapEngine {
+	HASHMAP_CHAINED = 0,	// DArray of buckets, every bucket is a DArray of nodes
+	HASHMAP_FLAT			// open addressing, nodes are stored inline in 'slots'
+} HashmapEngine;
+
+typedef struct HashmapNode {
+	void *key;
+	void *data;
+	uint32_t hash;
+} HashmapNode;
 
 typedef struct Hashmap {
+	HashmapEngine engine;
 	DArray *buckets;
+	HashmapNode *slots;
 	uint32_t default_number_of_buckets;
 	uint32_t default_max_load;
+	float load_factor;
 	uint32_t buckets_number;
 	uint32_t counter;	
+	uint32_t rehash_count;
+	// incremental rehash: 'old_buckets' are migrated to 'buckets'
+	// starting from 'rehash_index', 'rehash_step' == 0 turns it off
+	DArray *old_buckets;
+	uint32_t old_buckets_number;
+	uint32_t rehash_index;
+	uint32_t rehash_step;
+	uint32_t rehash_budget;
 	Hashmap_compare compare;
 	Hashmap_hash hash;
+	// used instead of 'hash' when set, with a random 'seed' for every map
+	Hashmap_keyed_hash keyed_hash;
+	uint64_t seed[2];
+	Pool *pool;
+	// counted only when built with -DHASHMAP_COUNT_COMPARES, atomically,
+	// so gets under a shared lock can count too
+	uint64_t lookups;
+	uint64_t compares;
 } Hashmap;
 
-typedef struct HashmapNode {
-	void *key;
-	void *data;
-	uint32_t hash;
-} HashmapNode;
+/*
+ * Snapshot made by Hashmap_stats. For the chained engine 'histogram'
+ * counts buckets by their number of nodes and 'longest' is the longest
+ * bucket, for the flat engine it counts nodes by their distance from
+ * the home slot and 'longest' is the longest distance. 'average_probes'
+ * is the mean number of node reads a get of a present key makes: binary
+ * search steps and compared nodes for chained, probed slots for flat.
+ */
+typedef struct HashmapStats {
+	uint32_t nodes;
+	uint32_t buckets;
+	uint32_t used_buckets;
+	uint32_t longest;
+	uint32_t histogram[HASHMAP_STATS_HISTOGRAM];
+	double average_probes;
+	size_t table_bytes;		// bucket table or slots
+	size_t bucket_bytes;	// bucket arrays of the chained engine
+	size_t node_bytes;
+	uint32_t rehash_count;
+	// set, get and delete lookups and key compares they made, 0 unless
+	// built with -DHASHMAP_COUNT_COMPARES
+	uint64_t lookups;
+	uint64_t compares;
+} HashmapStats;
 
 typedef int (*Hashmap_traverse_cb)(HashmapNode *node);
+typedef int (*Hashmap_traverse_ctx_cb)(HashmapNode *node, void *ctx);
+
+/*
+ * Cursor over the nodes of a map, see Hashmap_iter_init. 'buckets',
+ * 'bucket' and 'index' are the position of the chained engine, the
+ * flat one walks 'index' slots starting from 'start'.
+ */
+typedef struct HashmapIter {
+	Hashmap *map;
+	HashmapNode *current;
+	DArray *buckets;
+	uint32_t bucket;
+	uint32_t start;
+	int index;
+	int removed;
+} HashmapIter;
 
-Hashmap *Hashmap_create_advanced(Hashmap_compare compare, Hashmap_hash hash, uint32_t buckets_number, uint32_t max_load);
+/*
+ * 'buckets_number' is the initial number of buckets, 0 means
+ * DEFAULT_NUMBER_OF_BUCKETS.
+ *
+ * With 'max_load' > 0 the map grows linearly: it gets 'buckets_number'
+ * more buckets after every 'max_load' nodes and loses them the same way.
+ *
+ * With 'max_load' == 0 the number of buckets is a power of two, it
+ * doubles when there are more than 'load_factor' nodes per bucket and
+ * halves when there are less than a quarter of that. 0 'load_factor'
+ * means DEFAULT_LOAD_FACTOR. Hashmap_create uses this policy.
+ *
+ * NULL 'hash' means Hashmap_siphash with a random seed, so the keys
+ * that collide are different for every map and can't be picked in
+ * advance. Every create function works this way.
+ */
+Hashmap *Hashmap_create_advanced(Hashmap_compare compare, Hashmap_hash hash, uint32_t buckets_number, uint32_t max_load, float load_factor);
 Hashmap *Hashmap_create(Hashmap_compare compare, Hashmap_hash);
+
+/*
+ * Like Hashmap_create, but the nodes are taken from 'pool' and given
+ * back to it on delete and destroy. The caller owns the pool, it can
+ * be shared with other maps, trees or lists with big enough elements.
+ */
+Hashmap *Hashmap_create_pooled(Hashmap_compare compare, Hashmap_hash hash, Pool *pool);
+
+/*
+ * Creates a map with the flat (open addressing) engine. 'slots_number'
+ * is rounded up to a power of two, 0 means DEFAULT_NUMBER_OF_SLOTS.
+ * The rest of Hashmap API works the same for both engines, but node
+ * pointers passed to traverse callbacks are valid only until the next
+ * set or delete.
+ */
+Hashmap *Hashmap_create_flat(Hashmap_compare compare, Hashmap_hash hash, uint32_t slots_number);
+
 void Hashmap_destroy(Hashmap *map);
 
+/*
+ * Turns on incremental rehash for the chained engine: instead of moving
+ * every node at once, a new bucket table is created and every set, get
+ * or delete migrates at least 'rehash_step' old buckets into it (more
+ * if needed to finish before the next rehash is due). 0 turns it off
+ * and finishes a rehash in progress.
+ */
+int Hashmap_set_rehash_step(Hashmap *map, uint32_t rehash_step);
+
 int Hashmap_set(Hashmap *map, void *key, void *data);
 void *Hashmap_get(Hashmap *map, void *key);
 
+/*
+ * Batched get and set of 'n' keys. Keys are hashed and their buckets
+ * prefetched HASHMAP_PREFETCH_BATCH at a time before they are looked
+ * up, so the cache misses of a batch overlap. Hashmap_get_many puts
+ * the data of keys[i] (or NULL) to out[i] and returns the number of
+ * found keys. Hashmap_set_many stops at the first failed set.
+ *
+ * Both return -1 for a NULL key (or NULL data for set). Every batch is
+ * checked before it is hashed, so the batches before the bad one are
+ * already looked up or set.
+ */
+int Hashmap_get_many(Hashmap *map, void **keys, int n, void **out);
+int Hashmap_set_many(Hashmap *map, void **keys, void **data, int n);
+
 int Hashmap_traverse(Hashmap *map, Hashmap_traverse_cb traverse_cb);
 
 void *Hashmap_delete(Hashmap *map, void *key);
 
+/*
+ * The hash the map uses for 'key', with its seed. Keep it next to a key
+ * that is looked up many times and use the _prehashed calls, they skip
+ * hashing the key. The hash is only valid for this map, giving a wrong
+ * one makes the key not found (or set twice).
+ */
+uint32_t Hashmap_key_hash(Hashmap *map, void *key);
+int Hashmap_set_prehashed(Hashmap *map, void *key, uint32_t hash, void *data);
+void *Hashmap_get_prehashed(Hashmap *map, void *key, uint32_t hash);
+void *Hashmap_delete_prehashed(Hashmap *map, void *key, uint32_t hash);
+
+// fills the two words of 'seed' from getrandom(), or from the clock without it
+void Hashmap_random_seed(uint64_t *seed);
+
+/*
+ * Walks every node once:
+ *
+ *   HashmapIter iter;
+ *   Hashmap_iter_init(map, &iter);
+ *   while((node = Hashmap_iter_next(&iter)) != NULL) {
+ *       if(expired(node)) Hashmap_iter_remove_current(&iter);
+ *   }
+ *
+ * Hashmap_iter_remove_current deletes the current node and returns its
+ * data, the map doesn't shrink until the next Hashmap_delete. Any other
+ * set, get or delete during the walk may move nodes (a resize or an
+ * incremental rehash step), the iterator must be initialized again.
+ */
+void Hashmap_iter_init(Hashmap *map, HashmapIter *iter);
+HashmapNode *Hashmap_iter_next(HashmapIter *iter);
+void *Hashmap_iter_remove_current(HashmapIter *iter);
+
+// fills 'stats' walking the whole map, O(n log n) for the chained engine
+int Hashmap_stats(Hashmap *map, HashmapStats *stats);
+
+// Hashmap_traverse with a context pointer given to every callback
+int Hashmap_traverse_ctx(Hashmap *map, Hashmap_traverse_ctx_cb traverse_cb, void *ctx);
+
 #endif
@@ -1,5 +1,10 @@
 #include <lcthw/hashmap_algos.h>
 #include <lcthw/bstrlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 // settings taken from
 // http://www.isthe.com/chongo/tech/comp/fnv/index.html#FNV-param
@@ -101,3 +106,204 @@ uint32_t Hashmap_sdbm_hash(void *data)
 
 	return hash;
 }
+
+// constants and mixing of wyhash (public domain), https://github.com/wangyi-fudan/wyhash
+static const uint64_t WY_SECRET[4] = {
+	0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL,
+	0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL
+};
+
+static inline uint64_t Hashmap_wy_mix(uint64_t a, uint64_t b)
+{
+	__uint128_t r = (__uint128_t)a * b;
+
+	return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+// memcpy makes unaligned loads safe, compilers turn it into one mov
+static inline uint64_t Hashmap_read64(const uint8_t *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t Hashmap_read32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint64_t Hashmap_wy_bytes(const uint8_t *p, size_t len, uint64_t seed)
+{
+	uint64_t a = 0;
+	uint64_t b = 0;
+	uint64_t see1 = 0;
+	uint64_t see2 = 0;
+	size_t i = len;
+
+	seed ^= Hashmap_wy_mix(seed ^ WY_SECRET[0], WY_SECRET[1]);
+
+	if(len <= 16) {
+		if(len >= 4) {
+			// two overlapping reads cover 4 to 16 bytes
+			a = (Hashmap_read32(p) << 32) | Hashmap_read32(p + ((len >> 3) << 2));
+			b = (Hashmap_read32(p + len - 4) << 32) | Hashmap_read32(p + len - 4 - ((len >> 3) << 2));
+		} else if(len > 0) {
+			a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+		}
+	} else {
+		if(i > 48) {
+			see1 = see2 = seed;
+
+			do {
+				seed = Hashmap_wy_mix(Hashmap_read64(p) ^ WY_SECRET[1], Hashmap_read64(p + 8) ^ seed);
+				see1 = Hashmap_wy_mix(Hashmap_read64(p + 16) ^ WY_SECRET[2], Hashmap_read64(p + 24) ^ see1);
+				see2 = Hashmap_wy_mix(Hashmap_read64(p + 32) ^ WY_SECRET[3], Hashmap_read64(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while(i > 48);
+
+			seed ^= see1 ^ see2;
+		}
+
+		while(i > 16) {
+			seed = Hashmap_wy_mix(Hashmap_read64(p) ^ WY_SECRET[1], Hashmap_read64(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+
+		// the last 16 bytes, they may overlap the ones already mixed
+		a = Hashmap_read64(p + i - 16);
+		b = Hashmap_read64(p + i - 8);
+	}
+
+	__uint128_t r = (__uint128_t)(a ^ WY_SECRET[1]) * (b ^ seed);
+
+	return Hashmap_wy_mix((uint64_t)r ^ WY_SECRET[0] ^ len, (uint64_t)(r >> 64) ^ WY_SECRET[1]);
+}
+
+uint32_t Hashmap_wy_hash(void *data)
+{
+	bstring s = (bstring)data;
+	uint64_t hash = Hashmap_wy_bytes(s->data, blength(s), 0);
+
+	return (uint32_t)(hash ^ (hash >> 32));
+}
+
+// the most bytes that can be summed before 'b' could overflow 32 bits
+#define ADLER_NMAX 5552
+
+uint32_t Hashmap_adler32_simd_hash(void *data)
+{
+	bstring s = (bstring)data;
+	const uint8_t *p = s->data;
+	size_t len = blength(s);
+	uint64_t a = 1;
+	uint64_t b = 0;
+	size_t block = 0;
+	size_t i = 0;
+
+	while(len > 0) {
+		block = len < ADLER_NMAX ? len : ADLER_NMAX;
+		len -= block;
+
+#ifdef __SSE2__
+		if(block >= 16) {
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i weights_high = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+			const __m128i weights_low = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+			__m128i sum_a = zero;		// bytes of the block so far
+			__m128i sum_prefix = zero;	// 'sum_a' before every chunk
+			__m128i sum_b = zero;		// bytes weighted by position in the chunk
+			uint32_t lanes[4];
+			size_t chunks = block / 16;
+
+			for(i = 0; i < chunks; i++, p += 16) {
+				__m128i bytes = _mm_loadu_si128((const __m128i *)p);
+
+				sum_prefix = _mm_add_epi32(sum_prefix, sum_a);
+				sum_a = _mm_add_epi32(sum_a, _mm_sad_epu8(bytes, zero));
+				sum_b = _mm_add_epi32(sum_b, _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), weights_high));
+				sum_b = _mm_add_epi32(sum_b, _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), weights_low));
+			}
+
+			b += a * 16 * chunks;
+
+			_mm_storeu_si128((__m128i *)lanes, sum_prefix);
+			b += 16 * ((uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+
+			_mm_storeu_si128((__m128i *)lanes, sum_b);
+			b += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+			_mm_storeu_si128((__m128i *)lanes, sum_a);
+			a += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+			block -= chunks * 16;
+		}
+#endif
+
+		// the modulo is needed once per block only
+		for(i = 0; i < block; i++) {
+			a += p[i];
+			b += a;
+		}
+		p += block;
+
+		a %= MOD_ADLER;
+		b %= MOD_ADLER;
+	}
+
+	return (b << 16) | a;
+}
+
+#define SIP_ROTL(X, B) (((X) << (B)) | ((X) >> (64 - (B))))
+
+#define SIP_ROUND(V0, V1, V2, V3) do {\
+	V0 += V1; V1 = SIP_ROTL(V1, 13); V1 ^= V0; V0 = SIP_ROTL(V0, 32);\
+	V2 += V3; V3 = SIP_ROTL(V3, 16); V3 ^= V2;\
+	V0 += V3; V3 = SIP_ROTL(V3, 21); V3 ^= V0;\
+	V2 += V1; V1 = SIP_ROTL(V1, 17); V1 ^= V2; V2 = SIP_ROTL(V2, 32);\
+} while(0)
+
+// reference: https://github.com/veorq/SipHash, words are read little endian
+uint32_t Hashmap_siphash(void *data, const uint64_t *seed)
+{
+	bstring s = (bstring)data;
+	const uint8_t *p = s->data;
+	size_t len = blength(s);
+	const uint8_t *end = p + (len & ~(size_t)7);
+	uint64_t v0 = 0x736f6d6570736575ULL ^ seed[0];
+	uint64_t v1 = 0x646f72616e646f6dULL ^ seed[1];
+	uint64_t v2 = 0x6c7967656e657261ULL ^ seed[0];
+	uint64_t v3 = 0x7465646279746573ULL ^ seed[1];
+	uint64_t m = 0;
+	int i = 0;
+
+	for(; p != end; p += 8) {
+		m = Hashmap_read64(p);
+		v3 ^= m;
+		SIP_ROUND(v0, v1, v2, v3);
+		v0 ^= m;
+	}
+
+	// the tail bytes and the length make the last word
+	m = (uint64_t)len << 56;
+	for(i = (len & 7) - 1; i >= 0; i--) {
+		m |= (uint64_t)p[i] << (8 * i);
+	}
+
+	v3 ^= m;
+	SIP_ROUND(v0, v1, v2, v3);
+	v0 ^= m;
+
+	v2 ^= 0xff;
+	SIP_ROUND(v0, v1, v2, v3);
+	SIP_ROUND(v0, v1, v2, v3);
+	SIP_ROUND(v0, v1, v2, v3);
+
+	m = v0 ^ v1 ^ v2 ^ v3;
+
+	return (uint32_t)(m ^ (m >> 32));
+}
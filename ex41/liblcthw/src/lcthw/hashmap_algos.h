@@ -15,4 +15,23 @@ uint32_t Hashmap_loselose_hash(void *data);
 
 uint32_t Hashmap_sdbm_hash(void *data);
 
+/*
+ * Fast hashes for long keys. They read the key 8 or 16 bytes at a
+ * time straight from the bstring data instead of one checked
+ * character after another.
+ */
+
+// wyhash style: 64 bit multiply and fold over 16 (48 for long keys) bytes per step
+uint32_t Hashmap_wy_hash(void *data);
+
+// same result as Hashmap_adler32_hash, 16 bytes per step with SSE2
+uint32_t Hashmap_adler32_simd_hash(void *data);
+
+/*
+ * SipHash-1-3 of the bstring keyed with two 64 bit words of 'seed'.
+ * Without the seed nobody can find keys that collide, Hashmap uses it
+ * with a random seed per map when no hash function is given.
+ */
+uint32_t Hashmap_siphash(void *data, const uint64_t *seed);
+
 #endif
@@ -39,6 +39,36 @@ List *List_create()
 	return calloc(1, sizeof(List));
 }
 
+List *List_create_pooled(Pool *pool)
+{
+	check(pool, "pool can't be NULL");
+	check(pool->element_size >= sizeof(ListNode), "Pool elements are too small for ListNode.");
+
+	List *list = List_create();
+	check_mem(list);
+
+	list->pool = pool;
+
+	return list;
+
+error:
+	return NULL;
+}
+
+static inline ListNode *ListNode_create(List *list)
+{
+	return list->pool ? Pool_alloc(list->pool) : calloc(1, sizeof(ListNode));
+}
+
+static inline void ListNode_destroy(List *list, ListNode *node)
+{
+	if(list->pool) {
+		Pool_free(list->pool, node);
+	} else {
+		free(node);
+	}
+}
+
 void List_clear_destroy(List *list)
 {
 	assert(list != NULL && "list can't be NULL");
@@ -53,11 +83,28 @@ void List_clear_destroy(List *list)
 			free(cur->value);
 		}
 		if(cur->prev) {
-			free(cur->prev);
+			ListNode_destroy(list, cur->prev);
 		}
 	}
 
-	free(list->last);
+	if(list->last) {
+		ListNode_destroy(list, list->last);
+	}
+	free(list);
+}
+
+void List_destroy(List *list)
+{
+	assert(list != NULL && "list can't be NULL");
+
+	ListNode *node = list->first;
+	ListNode *next = NULL;
+
+	for(; node != NULL; node = next) {
+		next = node->next;
+		ListNode_destroy(list, node);
+	}
+
 	free(list);
 }
 
@@ -65,7 +112,7 @@ void List_push(List *list, void *value)
 {
 	assert(list != NULL && "list can't be NULL");
 
-	ListNode *node = calloc(1, sizeof(ListNode));
+	ListNode *node = ListNode_create(list);
 	check_mem(node);
 
 	node->value = value;
@@ -97,7 +144,7 @@ void List_unshift(List *list, void *value)
 {
 	assert(list != NULL && "list can't be NULL");
 
-	ListNode *node = calloc(1, sizeof(ListNode));
+	ListNode *node = ListNode_create(list);
 	check_mem(node);
 
 	node->value = value;
@@ -154,7 +201,7 @@ void *List_remove(List *list, ListNode *node)
 
 	list->count--;
 	result = node->value;
-	free(node);
+	ListNode_destroy(list, node);
 
 error:
 	return result;
@@ -167,6 +214,8 @@ List *List_copy(List *list)
 	List *list_copy = calloc(1, sizeof(List));
 	check_mem(list_copy);
 
+	list_copy->pool = list->pool;
+
 	LIST_FOREACH(list, first, next, cur) {
 		List_push(list_copy, cur->value);
 	}
@@ -195,6 +244,9 @@ int List_join_hidden(List *list, ...)
 		
 		// if we have no elements in the sub_list
 		if(!sub_list->last) continue;
+
+		// nodes must go back to the pool they came from
+		check(sub_list->pool == list->pool, "Can't join lists with different pools.");
 		
 		// if we have no elements in the list
 		if(!list->last) {
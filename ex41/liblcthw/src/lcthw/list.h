@@ -2,6 +2,7 @@
 #define lcthw_List_h
 
 #include <stdlib.h>
+#include <lcthw/pool.h>
 
 struct ListNode;
 
@@ -15,11 +16,20 @@ typedef struct List {
 	int count;
 	ListNode *first;
 	ListNode *last;
+	Pool *pool;
 } List;
 
 List *List_create();
+
+// nodes are taken from 'pool' owned by the caller, see Hashmap_create_pooled,
+// lists joined together must use the same pool
+List *List_create_pooled(Pool *pool);
+
 void List_clear_destroy(List *list);
 
+// frees the nodes and the list, but not the values
+void List_destroy(List *list);
+
 #define List_count(A) ((A)->count)
 #define List_first(A) ((A)->first != NULL ? (A)->first->value : NULL)
 #define List_last(A) ((A)->last != NULL ? (A)->last->value : NULL)
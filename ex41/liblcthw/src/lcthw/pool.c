@@ -0,0 +1,130 @@
+#include <lcthw/pool.h>
+#include <lcthw/dbg.h>
+
+// every element can hold the free list link and is aligned for any type
+#define POOL_ALIGN 16
+
+static inline size_t Pool_align(size_t size)
+{
+	return (size + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+}
+
+static inline char *Pool_slab_start(PoolSlab *slab)
+{
+	return (char *)slab + Pool_align(sizeof(PoolSlab));
+}
+
+Pool *Pool_create(size_t element_size, size_t slab_elements)
+{
+	Pool *pool = calloc(1, sizeof(Pool));
+	check_mem(pool);
+
+	check(element_size > 0, "You must set an element_size > 0.");
+
+	pool->element_size = Pool_align(element_size);
+	pool->slab_elements = slab_elements == 0 ? DEFAULT_SLAB_ELEMENTS : slab_elements;
+
+	return pool;
+
+error:
+	if(pool) free(pool);
+	return NULL;
+}
+
+void Pool_destroy(Pool *pool)
+{
+	PoolSlab *slab = NULL;
+	PoolSlab *next = NULL;
+
+	if(pool) {
+		for(slab = pool->first; slab != NULL; slab = next) {
+			next = slab->next;
+			free(slab);
+		}
+
+		free(pool);
+	}
+}
+
+static inline int Pool_next_slab(Pool *pool)
+{
+	PoolSlab *slab = pool->current ? pool->current->next : pool->first;
+
+	if(!slab) {
+		slab = malloc(Pool_align(sizeof(PoolSlab)) + pool->element_size * pool->slab_elements);
+		check_mem(slab);
+
+		slab->next = NULL;
+
+		if(pool->current) {
+			pool->current->next = slab;
+		} else {
+			pool->first = slab;
+		}
+	}
+
+	pool->current = slab;
+	pool->cursor = Pool_slab_start(slab);
+	pool->end = pool->cursor + pool->element_size * pool->slab_elements;
+
+	return 0;
+
+error:
+	return -1;
+}
+
+void *Pool_alloc(Pool *pool)
+{
+	void *el = NULL;
+
+	check(pool, "pool can't be NULL");
+
+	if(pool->free_list) {
+		el = pool->free_list;
+		pool->free_list = *(void **)el;
+	} else {
+		if(pool->cursor == pool->end) {
+			check(Pool_next_slab(pool) == 0, "Failed to get a new slab.");
+		}
+
+		el = pool->cursor;
+		pool->cursor += pool->element_size;
+	}
+
+	pool->count++;
+
+	return memset(el, 0, pool->element_size);
+
+error:
+	return NULL;
+}
+
+void Pool_free(Pool *pool, void *el)
+{
+	check(pool, "pool can't be NULL");
+
+	if(el) {
+		*(void **)el = pool->free_list;
+		pool->free_list = el;
+		pool->count--;
+	}
+
+error:
+	return;
+}
+
+void Pool_reset(Pool *pool)
+{
+	check(pool, "pool can't be NULL");
+
+	pool->free_list = NULL;
+	pool->count = 0;
+
+	// start cutting from the first slab again
+	pool->current = NULL;
+	pool->cursor = NULL;
+	pool->end = NULL;
+
+error:
+	return;
+}
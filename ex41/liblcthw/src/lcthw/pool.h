@@ -0,0 +1,44 @@
+#ifndef _lcthw_Pool_h
+#define _lcthw_Pool_h
+
+#include <stdlib.h>
+
+#define DEFAULT_SLAB_ELEMENTS 4096
+
+typedef struct PoolSlab {
+	struct PoolSlab *next;
+} PoolSlab;
+
+/*
+ * Fixed size element allocator. Elements are cut from big slabs and
+ * freed elements are kept in a free list for reuse, so the allocator
+ * is called once per slab instead of once per element.
+ */
+typedef struct Pool {
+	size_t element_size;
+	size_t slab_elements;
+	size_t count;			// elements in use
+	PoolSlab *first;		// slabs in the order they were made
+	PoolSlab *current;		// slab the elements are cut from
+	char *cursor;			// next uncut element in 'current'
+	char *end;
+	void *free_list;
+} Pool;
+
+// 0 'slab_elements' means DEFAULT_SLAB_ELEMENTS
+Pool *Pool_create(size_t element_size, size_t slab_elements);
+
+// frees all slabs, every element of the pool becomes invalid
+void Pool_destroy(Pool *pool);
+
+// returns a zeroed element
+void *Pool_alloc(Pool *pool);
+
+void Pool_free(Pool *pool, void *el);
+
+// makes every element free at once and keeps the slabs for reuse
+void Pool_reset(Pool *pool);
+
+#define Pool_count(P) ((P)->count)
+
+#endif
@@ -0,0 +1,172 @@
+#include <lcthw/sharded_hashmap.h>
+#include <lcthw/hashmap_algos.h>
+#include <lcthw/dbg.h>
+#include <stdlib.h>
+
+ShardedHashmap *ShardedHashmap_create(Hashmap_compare compare, Hashmap_hash hash, uint32_t shards_number)
+{
+	uint32_t i = 0;
+	uint32_t bits = 0;
+
+	ShardedHashmap *map = calloc(1, sizeof(ShardedHashmap));
+	check_mem(map);
+
+	if(hash == NULL) {
+		map->keyed_hash = Hashmap_siphash;
+		Hashmap_random_seed(map->seed);
+	} else {
+		map->hash = hash;
+	}
+
+	shards_number = shards_number == 0 ? DEFAULT_NUMBER_OF_SHARDS : shards_number;
+	check(shards_number <= (1UL << 16), "Too many shards: %u", shards_number);
+
+	for(bits = 0; (1U << bits) < shards_number; bits++);
+	map->shards_number = 1U << bits;
+	map->shard_shift = 32 - bits;
+
+	check(posix_memalign((void **)&map->shards, CACHE_LINE_SIZE, map->shards_number * sizeof(HashmapShard)) == 0,
+			"Out of memory.");
+	memset(map->shards, 0, map->shards_number * sizeof(HashmapShard));
+
+	for(i = 0; i < map->shards_number; i++) {
+		// the lock goes first, destroy takes a shard with a map as fully set up
+		check(pthread_rwlock_init(&map->shards[i].lock, NULL) == 0, "Failed to init shard lock.");
+
+		map->shards[i].map = Hashmap_create(compare, hash);
+		if(map->shards[i].map == NULL) {
+			pthread_rwlock_destroy(&map->shards[i].lock);
+			sentinel("Failed to create shard map.");
+		}
+
+		// so Hashmap_key_hash of a shard map agrees with the prehashed calls
+		map->shards[i].map->seed[0] = map->seed[0];
+		map->shards[i].map->seed[1] = map->seed[1];
+	}
+
+	return map;
+
+error:
+	if(map) {
+		ShardedHashmap_destroy(map);
+	}
+
+	return NULL;
+}
+
+void ShardedHashmap_destroy(ShardedHashmap *map)
+{
+	uint32_t i = 0;
+
+	if(map) {
+		if(map->shards) {
+			for(i = 0; i < map->shards_number; i++) {
+				if(map->shards[i].map) {
+					Hashmap_destroy(map->shards[i].map);
+					pthread_rwlock_destroy(&map->shards[i].lock);
+				}
+			}
+			free(map->shards);
+		}
+		free(map);
+	}
+}
+
+static inline uint32_t ShardedHashmap_hash_key(ShardedHashmap *map, void *key)
+{
+	return map->keyed_hash ? map->keyed_hash(key, map->seed) : map->hash(key);
+}
+
+static inline HashmapShard *ShardedHashmap_shard(ShardedHashmap *map, uint32_t hash)
+{
+	// a shift by 32 is undefined, one shard needs no bits at all
+	if(map->shards_number == 1) return map->shards;
+
+	return &map->shards[hash >> map->shard_shift];
+}
+
+int ShardedHashmap_set(ShardedHashmap *map, void *key, void *data)
+{
+	check(map, "map can't be NULL");
+	check(key, "key can't be NULL");
+
+	uint32_t hash = ShardedHashmap_hash_key(map, key);
+	HashmapShard *shard = ShardedHashmap_shard(map, hash);
+
+	pthread_rwlock_wrlock(&shard->lock);
+	int rc = Hashmap_set_prehashed(shard->map, key, hash, data);
+	pthread_rwlock_unlock(&shard->lock);
+
+	return rc;
+
+error:
+	return -1;
+}
+
+void *ShardedHashmap_get(ShardedHashmap *map, void *key)
+{
+	check(map, "map can't be NULL");
+	check(key, "key can't be NULL");
+
+	uint32_t hash = ShardedHashmap_hash_key(map, key);
+	HashmapShard *shard = ShardedHashmap_shard(map, hash);
+
+	// an incremental rehash would write on get, shard maps don't use it,
+	// and the -DHASHMAP_COUNT_COMPARES counters are atomic
+	pthread_rwlock_rdlock(&shard->lock);
+	void *data = Hashmap_get_prehashed(shard->map, key, hash);
+	pthread_rwlock_unlock(&shard->lock);
+
+	return data;
+
+error:
+	return NULL;
+}
+
+int ShardedHashmap_traverse(ShardedHashmap *map, Hashmap_traverse_cb traverse_cb)
+{
+	uint32_t i = 0;
+	int rc = 0;
+
+	for(i = 0; i < map->shards_number; i++) {
+		pthread_rwlock_rdlock(&map->shards[i].lock);
+		rc = Hashmap_traverse(map->shards[i].map, traverse_cb);
+		pthread_rwlock_unlock(&map->shards[i].lock);
+
+		if(rc != 0) return rc;
+	}
+
+	return 0;
+}
+
+void *ShardedHashmap_delete(ShardedHashmap *map, void *key)
+{
+	check(map, "map can't be NULL");
+	check(key, "key can't be NULL");
+
+	uint32_t hash = ShardedHashmap_hash_key(map, key);
+	HashmapShard *shard = ShardedHashmap_shard(map, hash);
+
+	pthread_rwlock_wrlock(&shard->lock);
+	void *data = Hashmap_delete_prehashed(shard->map, key, hash);
+	pthread_rwlock_unlock(&shard->lock);
+
+	return data;
+
+error:
+	return NULL;
+}
+
+uint32_t ShardedHashmap_count(ShardedHashmap *map)
+{
+	uint32_t i = 0;
+	uint32_t count = 0;
+
+	for(i = 0; i < map->shards_number; i++) {
+		pthread_rwlock_rdlock(&map->shards[i].lock);
+		count += map->shards[i].map->counter;
+		pthread_rwlock_unlock(&map->shards[i].lock);
+	}
+
+	return count;
+}
@@ -0,0 +1,52 @@
+#ifndef _lcthw_ShardedHashmap_h
+#define _lcthw_ShardedHashmap_h
+
+#include <stdint.h>
+#include <pthread.h>
+#include <lcthw/hashmap.h>
+
+#define DEFAULT_NUMBER_OF_SHARDS 16
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// every shard gets its own cache line, so the locks don't share one
+typedef struct HashmapShard {
+	pthread_rwlock_t lock;
+	Hashmap *map;
+} __attribute__((aligned(CACHE_LINE_SIZE))) HashmapShard;
+
+/*
+ * Thread safe Hashmap split into independent shards. A key goes to the
+ * shard picked by the high bits of its hash (the shard maps use the
+ * low bits for buckets), readers of one shard share its lock and
+ * writers take it exclusively. The key is hashed once, the shard map
+ * gets the same hash through the _prehashed calls.
+ */
+typedef struct ShardedHashmap {
+	uint32_t shards_number;
+	uint32_t shard_shift;
+	Hashmap_hash hash;
+	// like in Hashmap, used instead of 'hash' when set, the shard maps share 'seed'
+	Hashmap_keyed_hash keyed_hash;
+	uint64_t seed[2];
+	HashmapShard *shards;
+} ShardedHashmap;
+
+// 'shards_number' is rounded up to a power of two, 0 means DEFAULT_NUMBER_OF_SHARDS,
+// NULL 'hash' means Hashmap_siphash with a random seed
+ShardedHashmap *ShardedHashmap_create(Hashmap_compare compare, Hashmap_hash hash, uint32_t shards_number);
+void ShardedHashmap_destroy(ShardedHashmap *map);
+
+int ShardedHashmap_set(ShardedHashmap *map, void *key, void *data);
+void *ShardedHashmap_get(ShardedHashmap *map, void *key);
+
+// shards are traversed one by one, each under its read lock
+int ShardedHashmap_traverse(ShardedHashmap *map, Hashmap_traverse_cb traverse_cb);
+
+void *ShardedHashmap_delete(ShardedHashmap *map, void *key);
+
+uint32_t ShardedHashmap_count(ShardedHashmap *map);
+
+#endif
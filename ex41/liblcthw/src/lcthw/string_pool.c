@@ -0,0 +1,138 @@
+#include <lcthw/string_pool.h>
+#include <lcthw/dbg.h>
+
+// canonical strings start at pointer alignment
+#define STRING_POOL_ALIGN sizeof(void *)
+
+static inline size_t StringPool_align(size_t size)
+{
+	return (size + STRING_POOL_ALIGN - 1) & ~(size_t)(STRING_POOL_ALIGN - 1);
+}
+
+StringPool *StringPool_create(size_t chunk_size)
+{
+	StringPool *pool = calloc(1, sizeof(StringPool));
+	check_mem(pool);
+
+	pool->chunk_size = chunk_size == 0 ? DEFAULT_STRING_POOL_CHUNK_SIZE : chunk_size;
+
+	// no node per string, the slots hold the canonical string itself
+	pool->map = Hashmap_create_flat(NULL, NULL, 0);
+	check_mem(pool->map);
+
+	return pool;
+
+error:
+	if(pool) free(pool);
+	return NULL;
+}
+
+void StringPool_destroy(StringPool *pool)
+{
+	StringPoolChunk *chunk = NULL;
+	StringPoolChunk *next = NULL;
+
+	if(pool) {
+		for(chunk = pool->chunks; chunk != NULL; chunk = next) {
+			next = chunk->next;
+			free(chunk);
+		}
+
+		Hashmap_destroy(pool->map);
+		free(pool);
+	}
+}
+
+static void *StringPool_alloc(StringPool *pool, size_t size)
+{
+	void *memory = NULL;
+	size = StringPool_align(size);
+
+	if((size_t)(pool->end - pool->cursor) < size) {
+		// a string bigger than a chunk gets a chunk of its own
+		size_t chunk_size = size > pool->chunk_size ? size : pool->chunk_size;
+		StringPoolChunk *chunk = malloc(StringPool_align(sizeof(StringPoolChunk)) + chunk_size);
+		check_mem(chunk);
+
+		chunk->next = pool->chunks;
+		pool->chunks = chunk;
+		pool->bytes += StringPool_align(sizeof(StringPoolChunk)) + chunk_size;
+
+		pool->cursor = (char *)chunk + StringPool_align(sizeof(StringPoolChunk));
+		pool->end = pool->cursor + chunk_size;
+	}
+
+	memory = pool->cursor;
+	pool->cursor += size;
+
+	return memory;
+
+error:
+	return NULL;
+}
+
+bstring StringPool_intern_blk(StringPool *pool, const void *blk, int len)
+{
+	struct tagbstring probe;
+	bstring str = NULL;
+
+	check(pool, "pool can't be NULL");
+	check(blk != NULL && len >= 0, "Invalid string.");
+
+	blk2tbstr(probe, blk, len);
+
+	// hashed once for both the lookup and the insert
+	uint32_t hash = Hashmap_key_hash(pool->map, &probe);
+
+	str = Hashmap_get_prehashed(pool->map, &probe, hash);
+	if(str) return str;
+
+	str = StringPool_alloc(pool, sizeof(struct tagbstring) + len + 1);
+	check_mem(str);
+
+	str->data = (unsigned char *)(str + 1);
+	str->slen = len;
+	memcpy(str->data, blk, len);
+	str->data[len] = '\0';
+	str->mlen = len + 1;
+	bwriteprotect(*str);
+
+	check(Hashmap_set_prehashed(pool->map, str, hash, str) == 0, "Failed to add the string.");
+
+	return str;
+
+error:
+	// the memory stays in the chunk, it goes with the pool
+	return NULL;
+}
+
+bstring StringPool_intern(StringPool *pool, const_bstring str)
+{
+	check(str != NULL && str->slen >= 0, "Invalid string.");
+
+	return StringPool_intern_blk(pool, str->data, str->slen);
+
+error:
+	return NULL;
+}
+
+bstring StringPool_intern_cstr(StringPool *pool, const char *str)
+{
+	check(str, "str can't be NULL");
+
+	return StringPool_intern_blk(pool, str, strlen(str));
+
+error:
+	return NULL;
+}
+
+bstring StringPool_find(StringPool *pool, const_bstring str)
+{
+	check(pool, "pool can't be NULL");
+	check(str != NULL && str->slen >= 0, "Invalid string.");
+
+	return Hashmap_get(pool->map, (void *)str);
+
+error:
+	return NULL;
+}
@@ -0,0 +1,49 @@
+#ifndef _lcthw_StringPool_h
+#define _lcthw_StringPool_h
+
+#include <stdlib.h>
+#include <lcthw/bstrlib.h>
+#include <lcthw/hashmap.h>
+
+#define DEFAULT_STRING_POOL_CHUNK_SIZE (64 * 1024)
+
+typedef struct StringPoolChunk {
+	struct StringPoolChunk *next;
+} StringPoolChunk;
+
+/*
+ * Interning table: one canonical bstring for every distinct content,
+ * so equal interned strings are the same pointer. Canonical strings
+ * are cut with their data from big chunks (no allocation per string)
+ * and are write protected, bstrlib refuses to change or bdestroy them.
+ * They live until the pool is destroyed.
+ */
+typedef struct StringPool {
+	Hashmap *map;
+	size_t chunk_size;
+	StringPoolChunk *chunks;
+	char *cursor;			// free space in the newest chunk
+	char *end;
+	size_t bytes;			// taken by chunks
+} StringPool;
+
+// 0 'chunk_size' means DEFAULT_STRING_POOL_CHUNK_SIZE
+StringPool *StringPool_create(size_t chunk_size);
+
+// every canonical string of the pool becomes invalid
+void StringPool_destroy(StringPool *pool);
+
+// the canonical string with the content of 'str', added if needed
+bstring StringPool_intern(StringPool *pool, const_bstring str);
+bstring StringPool_intern_blk(StringPool *pool, const void *blk, int len);
+bstring StringPool_intern_cstr(StringPool *pool, const char *str);
+
+// the canonical string or NULL, never adds
+bstring StringPool_find(StringPool *pool, const_bstring str);
+
+// interned strings are equal only when they are the same string
+#define StringPool_equals(A, B) ((A) == (B))
+
+#define StringPool_count(P) ((P)->map->counter)
+
+#endif
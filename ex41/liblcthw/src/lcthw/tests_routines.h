@@ -8,6 +8,4 @@
 
 uint64_t get_diff(struct timespec start, struct timespec end);
 
-void stack_increase();
-
 #endif
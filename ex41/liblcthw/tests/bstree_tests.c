@@ -4,6 +4,8 @@
 #include <lcthw/bstrlib.h>
 #include <stdlib.h>
 #include <time.h>
+#include <stdint.h>
+#include <lcthw/tests_routines.h>
 
 BSTree *map = NULL;
 static int traverse_called = 0;
@@ -41,6 +43,15 @@ char *test_create()
 	return NULL;
 }
 
+char *test_create_balanced()
+{
+	map = BSTree_create_balanced(NULL);
+	mu_assert(map != NULL, "Failed to create map.");
+	mu_assert(map->engine == BSTREE_RED_BLACK, "Wrong engine.");
+
+	return NULL;
+}
+
 char *test_destroy()
 {
 	BSTree_destroy(map);
@@ -70,6 +81,7 @@ char *test_get_set()
 
 char *test_traverse()
 {
+	traverse_called = 0;
 	int rc = BSTree_traverse(map, traverse_good_cb);
 	mu_assert(rc == 0, "Failed to traverse.");
 	mu_assert(traverse_called == 3, "Wrong count traverse.");
@@ -148,6 +160,625 @@ char *test_fuzzing()
 	return NULL;
 }
 
+static int int_compare(void *a, void *b)
+{
+	intptr_t x = (intptr_t)a;
+	intptr_t y = (intptr_t)b;
+
+	return x < y ? -1 : x > y;
+}
+
+// black height of the subtree or -1 if it breaks a red-black or search tree rule
+static int red_black_height(BSTree *tree, BSTreeNode *node)
+{
+	if(node == NULL) return 1;
+
+	if(node->left && (node->left->parent != node || tree->compare(node->key, node->left->key) > 0)) return -1;
+	if(node->right && (node->right->parent != node || tree->compare(node->key, node->right->key) < 0)) return -1;
+
+	if(node->color == BSTREE_RED &&
+			((node->left && node->left->color == BSTREE_RED) ||
+			 (node->right && node->right->color == BSTREE_RED))) {
+		return -1;
+	}
+
+	int left = red_black_height(tree, node->left);
+	int right = red_black_height(tree, node->right);
+
+	if(left < 0 || left != right) return -1;
+
+	return left + (node->color == BSTREE_BLACK);
+}
+
+// walks with the parent pointers, a plain tree of sorted keys is too deep for recursion
+static int tree_height(BSTree *tree)
+{
+	BSTreeNode *node = tree->root;
+	BSTreeNode *from = NULL;
+	int depth = 1;
+	int height = 0;
+
+	while(node) {
+		if(depth > height) height = depth;
+
+		if(from == node->parent && node->left) {
+			from = node;
+			node = node->left;
+			depth++;
+		} else if((from == node->parent || from == node->left) && node->right) {
+			from = node;
+			node = node->right;
+			depth++;
+		} else {
+			from = node;
+			node = node->parent;
+			depth--;
+		}
+	}
+
+	return height;
+}
+
+#define BALANCED_FUZZ_KEYS 1000
+#define BALANCED_FUZZ_OPERATIONS 20000
+
+char *test_balanced_fuzzing()
+{
+	BSTree *store = BSTree_create_balanced(int_compare);
+	int present[BALANCED_FUZZ_KEYS] = {0};
+	int count = 0;
+	int i = 0;
+
+	for(i = 0; i < BALANCED_FUZZ_OPERATIONS; i++) {
+		intptr_t key = rand() % BALANCED_FUZZ_KEYS;
+
+		if(rand() % 3 == 0) {
+			void *data = BSTree_delete(store, (void *)key);
+			mu_assert(data == (present[key] ? (void *)(key + 1) : NULL), "Wrong deleted data.");
+			count -= present[key];
+			present[key] = 0;
+		} else {
+			mu_assert(BSTree_set(store, (void *)key, (void *)(key + 1)) == 0, "Failed to set.");
+			count += !present[key];
+			present[key] = 1;
+		}
+
+		mu_assert(store->count == count, "Wrong count.");
+
+		if(i % 100 == 0) {
+			mu_assert(red_black_height(store, store->root) > 0, "Red-black rules are broken.");
+			mu_assert(store->root == NULL || store->root->color == BSTREE_BLACK, "Root should be black.");
+		}
+	}
+
+	for(i = 0; i < BALANCED_FUZZ_KEYS; i++) {
+		mu_assert(BSTree_get(store, (void *)(intptr_t)i) == (present[i] ? (void *)(intptr_t)(i + 1) : NULL),
+				"Wrong data.");
+	}
+
+	BSTree_destroy(store);
+
+	return NULL;
+}
+
+#define RANGE_KEYS 2000
+
+static int range_cb(BSTreeNode *node, void *ctx)
+{
+	intptr_t *expected = ctx;
+
+	// keys come in order, one after another
+	if((intptr_t)node->key != *expected) return 1;
+
+	*expected += 2;
+	return 0;
+}
+
+static int range_stop_cb(BSTreeNode *node, void *ctx)
+{
+	(void)node;
+	return ++*(int *)ctx == 3 ? 7 : 0;
+}
+
+static char *run_range(BSTree *tree, const char *name)
+{
+	BSTreeNode *node = NULL;
+	intptr_t expected = 0;
+	intptr_t i = 0;
+	int called = 0;
+
+	debug("Range %s", name);
+
+	mu_assert(BSTree_first(tree) == NULL && BSTree_last(tree) == NULL, "Empty tree has no first or last.");
+	mu_assert(BSTree_lower_bound(tree, (void *)1) == NULL, "Empty tree has no lower bound.");
+
+	// even keys only, in random order
+	for(i = 0; i < RANGE_KEYS; i++) {
+		intptr_t key = 2 * ((i * 7919) % RANGE_KEYS);
+		mu_assert(BSTree_set(tree, (void *)key, (void *)key) == 0, "Failed to set.");
+	}
+
+	mu_assert(BSTree_first(tree)->key == (void *)0, "Wrong first key.");
+	mu_assert(BSTree_last(tree)->key == (void *)(2 * (RANGE_KEYS - 1)), "Wrong last key.");
+
+	for(node = BSTree_first(tree), i = 0; node != NULL; node = BSTree_next(node), i += 2) {
+		mu_assert(node->key == (void *)i, "Wrong key going forward.");
+	}
+	mu_assert(i == 2 * RANGE_KEYS, "Cursor missed keys.");
+
+	for(node = BSTree_last(tree), i = 2 * (RANGE_KEYS - 1); node != NULL; node = BSTree_prev(node), i -= 2) {
+		mu_assert(node->key == (void *)i, "Wrong key going back.");
+	}
+	mu_assert(i == -2, "Cursor missed keys.");
+
+	mu_assert(BSTree_lower_bound(tree, (void *)10)->key == (void *)10, "Lower bound of a key is the key.");
+	mu_assert(BSTree_lower_bound(tree, (void *)11)->key == (void *)12, "Wrong lower bound.");
+	mu_assert(BSTree_lower_bound(tree, (void *)-5)->key == (void *)0, "Wrong lower bound.");
+	mu_assert(BSTree_lower_bound(tree, (void *)(2 * RANGE_KEYS)) == NULL, "No key is that big.");
+
+	expected = 100;
+	mu_assert(BSTree_range(tree, (void *)99, (void *)200, range_cb, &expected) == 0, "Failed range.");
+	mu_assert(expected == 202, "Range should end at the high key.");
+
+	expected = 0;
+	mu_assert(BSTree_range(tree, (void *)-1, (void *)(3 * RANGE_KEYS), range_cb, &expected) == 0, "Failed range.");
+	mu_assert(expected == 2 * RANGE_KEYS, "Range should have every key.");
+
+	expected = 0;
+	mu_assert(BSTree_range(tree, (void *)13, (void *)13, range_cb, &expected) == 0, "Failed range.");
+	mu_assert(expected == 0, "Range should be empty.");
+
+	mu_assert(BSTree_range(tree, (void *)0, (void *)100, range_stop_cb, &called) == 7, "Range should stop.");
+	mu_assert(called == 3, "Range should stop at the callback.");
+
+	return NULL;
+}
+
+char *test_range()
+{
+	char *message = NULL;
+
+	BSTree *plain = BSTree_create(int_compare);
+	message = run_range(plain, "plain");
+	BSTree_destroy(plain);
+	if(message) return message;
+
+	BSTree *balanced = BSTree_create_balanced(int_compare);
+	message = run_range(balanced, "red-black");
+	BSTree_destroy(balanced);
+
+	return message;
+}
+
+char *test_range_duplicates()
+{
+	struct tagbstring key = bsStatic("same key");
+	BSTree *tree = BSTree_create(NULL);
+	BSTreeNode *node = NULL;
+
+	BSTree_set(tree, &test1, &expect1);
+	BSTree_set(tree, &key, &expect1);
+	BSTree_set(tree, &test3, &expect3);
+	BSTree_set(tree, &key, &expect2);
+	BSTree_set(tree, &key, &expect3);
+
+	// the plain tree keeps equal keys in the order they were set
+	node = BSTree_lower_bound(tree, &key);
+	mu_assert(node->data == &expect1, "Wrong first equal key.");
+	node = BSTree_next(node);
+	mu_assert(node->data == &expect2, "Wrong second equal key.");
+	node = BSTree_next(node);
+	mu_assert(node->data == &expect3, "Wrong third equal key.");
+	mu_assert(BSTree_next(node)->key == &test1, "Wrong key after the equal keys.");
+
+	BSTree_destroy(tree);
+
+	return NULL;
+}
+
+static char *run_build_sorted(BSTree *tree, int n, const char *name)
+{
+	void *keys[256];
+	void *values[256];
+	intptr_t i = 0;
+
+	debug("Build sorted %s of %d keys", name, n);
+
+	for(i = 0; i < n; i++) {
+		keys[i] = (void *)(2 * i);
+		values[i] = (void *)(2 * i + 1);
+	}
+
+	mu_assert(BSTree_build_sorted(tree, keys, values, n) == 0, "Failed to build.");
+	mu_assert(tree->count == n, "Wrong count.");
+	mu_assert(red_black_height(tree, tree->root) > 0, "Built tree isn't balanced.");
+
+	for(i = 0; i < n; i++) {
+		mu_assert(BSTree_get(tree, keys[i]) == values[i], "Wrong value.");
+		mu_assert(BSTree_get(tree, (void *)(2 * i + 1)) == NULL, "Key shouldn't be there.");
+	}
+
+	// the built tree works like any other
+	mu_assert(BSTree_set(tree, (void *)-1, (void *)-1) == 0, "Failed to set.");
+	for(i = 0; i < n; i += 2) {
+		mu_assert(BSTree_delete(tree, keys[i]) == values[i], "Failed to delete.");
+	}
+	mu_assert(BSTree_get(tree, (void *)-1) == (void *)-1, "Wrong value.");
+
+	if(tree->engine == BSTREE_RED_BLACK) {
+		mu_assert(red_black_height(tree, tree->root) > 0, "Red-black rules are broken.");
+	}
+
+	return NULL;
+}
+
+char *test_build_sorted()
+{
+	char *message = NULL;
+	void *unsorted[] = {(void *)2, (void *)1};
+	int n = 0;
+
+	BSTree *tree = BSTree_create_balanced(int_compare);
+	mu_assert(BSTree_build_sorted(tree, unsorted, NULL, 2) == -1, "Unsorted keys should fail.");
+	mu_assert(BSTree_build_sorted(tree, unsorted, NULL, 0) == 0 && tree->root == NULL, "No keys is an empty tree.");
+	BSTree_destroy(tree);
+
+	for(n = 1; n <= 256; n = n < 20 ? n + 1 : n * 2) {
+		tree = BSTree_create_balanced(int_compare);
+		message = run_build_sorted(tree, n, "red-black");
+		BSTree_destroy(tree);
+		if(message) return message;
+
+		tree = BSTree_create(int_compare);
+		message = run_build_sorted(tree, n, "plain");
+		BSTree_destroy(tree);
+		if(message) return message;
+	}
+
+	tree = BSTree_create(int_compare);
+	mu_assert(BSTree_build_sorted(tree, unsorted + 1, NULL, 1) == 0, "Failed to build.");
+	mu_assert(BSTree_build_sorted(tree, unsorted, NULL, 1) == -1, "Only an empty map can be built.");
+	BSTree_delete(tree, unsorted[1]);
+	mu_assert(BSTree_build_sorted(tree, unsorted, NULL, 1) == 0, "An emptied map can be built again.");
+	BSTree_destroy(tree);
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DBUILD_KEYS=... for longer runs
+#ifndef BUILD_KEYS
+#define BUILD_KEYS 1000000
+#endif
+
+char *test_build_sorted_perfomance()
+{
+	struct timespec start, end;
+	void **keys = calloc(BUILD_KEYS, sizeof(void *));
+	double set_ms, build_ms, set_get_ns, build_get_ns;
+	void *key = NULL;
+	intptr_t i = 0;
+
+	mu_assert(keys != NULL, "Failed to allocate keys.");
+
+	for(i = 0; i < BUILD_KEYS; i++) {
+		keys[i] = (void *)(i + 1);
+	}
+
+	BSTree *set = BSTree_create_balanced(int_compare);
+	BSTree *built = BSTree_create_balanced(int_compare);
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 0; i < BUILD_KEYS; i++) {
+		BSTree_set(set, keys[i], keys[i]);
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	set_ms = (double)get_diff(start, end) / 1000000;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	mu_assert(BSTree_build_sorted(built, keys, keys, BUILD_KEYS) == 0, "Failed to build.");
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	build_ms = (double)get_diff(start, end) / 1000000;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 0; i < BUILD_KEYS; i++) {
+		key = (void *)((i * 7919) % BUILD_KEYS + 1);
+		mu_assert(BSTree_get(set, key) == key, "Wrong value.");
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	set_get_ns = (double)get_diff(start, end) / BUILD_KEYS;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 0; i < BUILD_KEYS; i++) {
+		key = (void *)((i * 7919) % BUILD_KEYS + 1);
+		mu_assert(BSTree_get(built, key) == key, "Wrong value.");
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	build_get_ns = (double)get_diff(start, end) / BUILD_KEYS;
+
+	printf("\nBSTree of %d sorted keys: BSTree_set took %lf ms (height %d, get %lf ns), "
+			"BSTree_build_sorted took %lf ms (height %d, get %lf ns).\n",
+			BUILD_KEYS, set_ms, tree_height(set), set_get_ns, build_ms, tree_height(built), build_get_ns);
+
+	BSTree_destroy(set);
+	BSTree_destroy(built);
+	free(keys);
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DRANGE_BENCH_KEYS=... for longer runs
+#ifndef RANGE_BENCH_KEYS
+#define RANGE_BENCH_KEYS 1000000
+#endif
+
+#define RANGE_BENCH_WIDTH 100
+#define RANGE_BENCH_QUERIES 1000
+
+typedef struct RangeFilter {
+	intptr_t low;
+	intptr_t high;
+	int found;
+} RangeFilter;
+
+static RangeFilter traverse_filter;
+
+static int traverse_filter_cb(BSTreeNode *node)
+{
+	traverse_filter.found += (intptr_t)node->key >= traverse_filter.low && (intptr_t)node->key <= traverse_filter.high;
+	return 0;
+}
+
+static int range_count_cb(BSTreeNode *node, void *ctx)
+{
+	(void)node;
+	((RangeFilter *)ctx)->found++;
+	return 0;
+}
+
+char *test_range_perfomance()
+{
+	struct timespec start, end;
+	RangeFilter filter = {0};
+	double range_ns, traverse_ns;
+	intptr_t i = 0;
+	int query = 0;
+
+	BSTree *tree = BSTree_create_balanced(int_compare);
+
+	for(i = 0; i < RANGE_BENCH_KEYS; i++) {
+		BSTree_set(tree, (void *)i, (void *)i);
+	}
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(query = 0; query < RANGE_BENCH_QUERIES; query++) {
+		filter.low = rand() % (RANGE_BENCH_KEYS - RANGE_BENCH_WIDTH);
+		filter.high = filter.low + RANGE_BENCH_WIDTH - 1;
+		filter.found = 0;
+
+		BSTree_range(tree, (void *)filter.low, (void *)filter.high, range_count_cb, &filter);
+		mu_assert(filter.found == RANGE_BENCH_WIDTH, "Wrong range.");
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	range_ns = (double)get_diff(start, end) / RANGE_BENCH_QUERIES;
+
+	// walking the whole tree is what a range took before, a few queries do
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(query = 0; query < 10; query++) {
+		traverse_filter.low = rand() % (RANGE_BENCH_KEYS - RANGE_BENCH_WIDTH);
+		traverse_filter.high = traverse_filter.low + RANGE_BENCH_WIDTH - 1;
+		traverse_filter.found = 0;
+
+		BSTree_traverse(tree, traverse_filter_cb);
+		mu_assert(traverse_filter.found == RANGE_BENCH_WIDTH, "Wrong filtered range.");
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	traverse_ns = (double)get_diff(start, end) / 10;
+
+	printf("\n%d keys from a BSTree of %d: BSTree_range took %lf, filtered BSTree_traverse took %lf nanoseconds.\n",
+			RANGE_BENCH_WIDTH, RANGE_BENCH_KEYS, range_ns, traverse_ns);
+
+	BSTree_destroy(tree);
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DSORTED_KEYS=10000000 for the 10M row, the plain
+// tree is quadratic on sorted keys, so it gets PLAIN_SORTED_KEYS only
+#define ORDER_KEYS 7
+
+static intptr_t visited[ORDER_KEYS];
+static int visited_count = 0;
+
+static int order_cb(BSTreeNode *node)
+{
+	visited[visited_count++] = (intptr_t)node->key;
+	return 0;
+}
+
+static int order_stop_cb(BSTreeNode *node)
+{
+	visited[visited_count++] = (intptr_t)node->key;
+	return (intptr_t)node->key == 4 ? 4 : 0;
+}
+
+// a post-order walk may free every node it is done with
+static int order_free_cb(BSTreeNode *node)
+{
+	visited[visited_count++] = (intptr_t)node->key;
+	free(node);
+	return 0;
+}
+
+// 1 if 'tree' is visited in 'order' as 'expect'
+static int check_order(BSTree *tree, BSTreeOrder order, intptr_t *expect)
+{
+	int i = 0;
+
+	visited_count = 0;
+	if(BSTree_traverse_order(tree, order, order_cb) != 0 || visited_count != ORDER_KEYS) return 0;
+
+	for(i = 0; i < ORDER_KEYS; i++) {
+		if(visited[i] != expect[i]) return 0;
+	}
+
+	return 1;
+}
+
+char *test_traverse_order()
+{
+	// bigger keys go left: 4 has 6 (7, 5) on the left and 2 (3, 1) on the right
+	intptr_t keys[ORDER_KEYS] = {4, 2, 6, 1, 3, 5, 7};
+	intptr_t pre[ORDER_KEYS] = {4, 6, 7, 5, 2, 3, 1};
+	intptr_t in[ORDER_KEYS] = {1, 2, 3, 4, 5, 6, 7};
+	intptr_t post[ORDER_KEYS] = {7, 5, 6, 3, 1, 2, 4};
+	int i = 0;
+
+	BSTree *tree = BSTree_create(int_compare);
+
+	for(i = 0; i < ORDER_KEYS; i++) {
+		mu_assert(BSTree_set(tree, (void *)keys[i], NULL) == 0, "Failed to set.");
+	}
+
+	mu_assert(check_order(tree, BSTREE_PRE_ORDER, pre), "Wrong pre-order.");
+	mu_assert(check_order(tree, BSTREE_IN_ORDER, in), "Wrong in-order.");
+	mu_assert(check_order(tree, BSTREE_POST_ORDER, post), "Wrong post-order.");
+
+	// a stop in the middle returns the callback result
+	visited_count = 0;
+	mu_assert(BSTree_traverse_order(tree, BSTREE_IN_ORDER, order_stop_cb) == 4, "Failed to stop.");
+	mu_assert(visited_count == 4, "Wrong count traverse for stop.");
+
+	visited_count = 0;
+	mu_assert(BSTree_traverse_order(tree, BSTREE_POST_ORDER, order_free_cb) == 0, "Failed to free.");
+	for(i = 0; i < ORDER_KEYS; i++) {
+		mu_assert(visited[i] == post[i], "Wrong post-order while freeing.");
+	}
+
+	tree->root = NULL;
+	BSTree_destroy(tree);
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DDEEP_KEYS=... for deeper trees
+#ifndef DEEP_KEYS
+#define DEEP_KEYS 4000000
+#endif
+
+static intptr_t deep_next = 0;
+
+static int deep_cb(BSTreeNode *node)
+{
+	return (intptr_t)node->key != deep_next++;
+}
+
+static int deep_reverse_cb(BSTreeNode *node)
+{
+	return (intptr_t)node->key != deep_next--;
+}
+
+char *test_deep_tree()
+{
+	BSTree *tree = BSTree_create(int_compare);
+	BSTreeNode *node = NULL;
+	BSTreeNode *parent = NULL;
+	intptr_t i = 0;
+
+	// a plain tree of sorted keys is one left chain, linked by hand as inserts are quadratic
+	for(i = 0; i < DEEP_KEYS; i++) {
+		node = calloc(1, sizeof(BSTreeNode));
+		mu_assert(node != NULL, "Failed to allocate a node.");
+
+		node->key = (void *)i;
+		node->data = (void *)(i + 1);
+		node->parent = parent;
+
+		if(parent) {
+			parent->left = node;
+		} else {
+			tree->root = node;
+		}
+
+		parent = node;
+	}
+	tree->count = DEEP_KEYS;
+
+	mu_assert(BSTree_get(tree, (void *)(intptr_t)(DEEP_KEYS - 1)) == (void *)(intptr_t)DEEP_KEYS, "Failed to get the deepest key.");
+
+	deep_next = 0;
+	mu_assert(BSTree_traverse_order(tree, BSTREE_PRE_ORDER, deep_cb) == 0, "Wrong deep pre-order.");
+	deep_next = 0;
+	mu_assert(BSTree_traverse_order(tree, BSTREE_IN_ORDER, deep_cb) == 0, "Wrong deep in-order.");
+	deep_next = DEEP_KEYS - 1;
+	mu_assert(BSTree_traverse(tree, deep_reverse_cb) == 0, "Wrong deep post-order.");
+
+	BSTree_destroy(tree);
+
+	return NULL;
+}
+
+#ifndef SORTED_KEYS
+#define SORTED_KEYS 1000000
+#endif
+
+#ifndef PLAIN_SORTED_KEYS
+#define PLAIN_SORTED_KEYS 20000
+#endif
+
+static char *run_sorted_perfomance(BSTree *tree, int count, const char *name)
+{
+	struct timespec start, end;
+	double set_ns, get_ns;
+	intptr_t i = 0;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 1; i <= count; i++) {
+		mu_assert(BSTree_set(tree, (void *)i, (void *)i) == 0, "Failed to set.");
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	set_ns = (double)get_diff(start, end) / count;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 1; i <= count; i++) {
+		mu_assert(BSTree_get(tree, (void *)i) == (void *)i, "Wrong value.");
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	get_ns = (double)get_diff(start, end) / count;
+
+	printf("\nBSTree %s with %d sorted keys: height %d, set took %lf, get took %lf nanoseconds.\n",
+			name, count, tree_height(tree), set_ns, get_ns);
+
+	return NULL;
+}
+
+char *test_sorted_perfomance()
+{
+	char *message = NULL;
+	int bound = 0;
+	int n = 0;
+
+	BSTree *plain = BSTree_create(int_compare);
+	message = run_sorted_perfomance(plain, PLAIN_SORTED_KEYS, "(plain)");
+	BSTree_destroy(plain);
+	if(message) return message;
+
+	BSTree *balanced = BSTree_create_balanced(int_compare);
+	message = run_sorted_perfomance(balanced, PLAIN_SORTED_KEYS, "(red-black)");
+	BSTree_destroy(balanced);
+	if(message) return message;
+
+	balanced = BSTree_create_balanced(int_compare);
+	message = run_sorted_perfomance(balanced, SORTED_KEYS, "(red-black)");
+
+	// at most 2 log2(n + 1)
+	for(bound = 0, n = SORTED_KEYS + 1; n > 1; n >>= 1) bound++;
+	mu_assert(tree_height(balanced) <= 2 * (bound + 1), "Red-black tree is too high.");
+
+	BSTree_destroy(balanced);
+
+	return message;
+}
+
 char *all_tests()
 {
 	mu_suite_start();
@@ -159,6 +790,23 @@ char *all_tests()
 	mu_run_test(test_destroy);
 	mu_run_test(test_fuzzing);
 
+	mu_run_test(test_create_balanced);
+	mu_run_test(test_get_set);
+	mu_run_test(test_traverse);
+	mu_run_test(test_delete);
+	mu_run_test(test_destroy);
+	mu_run_test(test_balanced_fuzzing);
+
+	mu_run_test(test_range);
+	mu_run_test(test_range_duplicates);
+	mu_run_test(test_build_sorted);
+	mu_run_test(test_traverse_order);
+	mu_run_test(test_deep_tree);
+
+	mu_run_test(test_sorted_perfomance);
+	mu_run_test(test_range_perfomance);
+	mu_run_test(test_build_sorted_perfomance);
+
 	return NULL;
 }
 
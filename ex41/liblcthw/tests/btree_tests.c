@@ -0,0 +1,380 @@
+#include "minunit.h"
+#include <lcthw/btree.h>
+#include <lcthw/bstree.h>
+#include <lcthw/bstrlib.h>
+#include <lcthw/tests_routines.h>
+#include <stdint.h>
+
+BTree *map = NULL;
+static int traverse_called = 0;
+struct tagbstring test1 = bsStatic("test data 1");
+struct tagbstring test2 = bsStatic("test data 2");
+struct tagbstring test3 = bsStatic("xest data 3");
+struct tagbstring expect1 = bsStatic("THE VALUE 1");
+struct tagbstring expect2 = bsStatic("THE VALUE 2");
+struct tagbstring expect3 = bsStatic("THE VALUE 3");
+
+static int traverse_good_cb(void *key, void *data)
+{
+	(void)data;
+	debug("KEY: %s", bdata((bstring)key));
+	traverse_called++;
+	return 0;
+}
+
+static int traverse_fail_cb(void *key, void *data)
+{
+	(void)data;
+	debug("KEY: %s", bdata((bstring)key));
+	traverse_called++;
+
+	if(traverse_called == 2) {
+		return 1;
+	} else {
+		return 0;
+	}
+}
+
+char *test_create()
+{
+	map = BTree_create(NULL);
+	mu_assert(map != NULL, "Failed to create map.");
+	mu_assert(map->root != NULL && map->root->leaf, "Root should be an empty leaf.");
+
+	return NULL;
+}
+
+char *test_destroy()
+{
+	BTree_destroy(map);
+
+	return NULL;
+}
+
+char *test_get_set()
+{
+	int rc = BTree_set(map, &test1, &expect1);
+	mu_assert(rc == 0, "Failed to set test1.");
+	mu_assert(BTree_get(map, &test1) == &expect1, "Wrong value for test1.");
+
+	rc = BTree_set(map, &test3, &expect3);
+	mu_assert(rc == 0, "Failed to set test3.");
+	mu_assert(BTree_get(map, &test3) == &expect3, "Wrong value for test3.");
+
+	rc = BTree_set(map, &test2, &expect2);
+	mu_assert(rc == 0, "Failed to set test2.");
+	mu_assert(BTree_get(map, &test2) == &expect2, "Wrong value for test2.");
+
+	rc = BTree_set(map, &test1, &expect3);
+	mu_assert(rc == 0, "Failed to replace test1.");
+	mu_assert(BTree_get(map, &test1) == &expect3, "Wrong replaced value for test1.");
+	mu_assert(map->count == 3, "Replace should keep the count.");
+
+	BTree_set(map, &test1, &expect1);
+
+	return NULL;
+}
+
+char *test_traverse()
+{
+	int rc = BTree_traverse(map, traverse_good_cb);
+	mu_assert(rc == 0, "Failed to traverse.");
+	mu_assert(traverse_called == 3, "Wrong count traverse.");
+
+	traverse_called = 0;
+	rc = BTree_traverse(map, traverse_fail_cb);
+	mu_assert(rc == 1, "Failed to traverse.");
+	mu_assert(traverse_called == 2, "Wrong count traverse for fail.");
+
+	// in key order, test2 was set last
+	BTreeIter iter;
+	void *key = NULL;
+	void *data = NULL;
+
+	BTree_iter_init(map, &iter);
+	mu_assert(BTree_iter_next(&iter, &key, &data) && key == &test1 && data == &expect1, "Wrong first key.");
+	mu_assert(BTree_iter_next(&iter, &key, NULL) && key == &test2, "Wrong second key.");
+	mu_assert(BTree_iter_next(&iter, &key, NULL) && key == &test3, "Wrong third key.");
+	mu_assert(!BTree_iter_next(&iter, &key, NULL), "Iteration should end.");
+
+	return NULL;
+}
+
+char *test_delete()
+{
+	mu_assert(BTree_delete(map, &test1) == &expect1, "Should get test1.");
+	mu_assert(BTree_get(map, &test1) == NULL, "Should delete.");
+	mu_assert(BTree_delete(map, &test1) == NULL, "Should delete only once.");
+
+	mu_assert(BTree_delete(map, &test2) == &expect2, "Should get test2.");
+	mu_assert(BTree_delete(map, &test3) == &expect3, "Should get test3.");
+	mu_assert(map->count == 0, "Wrong count.");
+
+	return NULL;
+}
+
+static int int_compare(void *a, void *b)
+{
+	intptr_t x = (intptr_t)a;
+	intptr_t y = (intptr_t)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Checks the subtree of 'node' at 'depth' holds keys in [low, high)
+ * (NULL means unbounded) and follows the B+ tree rules, 'low' has to
+ * be the very first key. Returns the number of keys or -1.
+ */
+static int btree_check(BTree *tree, BTreeNode *node, int depth, void *low, void *high)
+{
+	int count = 0;
+	int child = 0;
+	int i = 0;
+
+	if(node != tree->root && node->count < BTREE_MIN_KEYS) return -1;
+	if(node->count > BTREE_MAX_KEYS) return -1;
+
+	for(i = 0; i < node->count; i++) {
+		if(i > 0 && tree->compare(node->keys[i - 1], node->keys[i]) >= 0) return -1;
+		if(low && tree->compare(node->keys[i], low) < 0) return -1;
+		if(high && tree->compare(node->keys[i], high) >= 0) return -1;
+	}
+
+	if(node->leaf) {
+		if(low && (node->count == 0 || node->keys[0] != low)) return -1;
+
+		return depth == tree->height ? node->count : -1;
+	}
+
+	for(i = 0; i <= node->count; i++) {
+		child = btree_check(tree, node->children[i], depth + 1,
+				i > 0 ? node->keys[i - 1] : low, i < node->count ? node->keys[i] : high);
+		if(child < 0) return -1;
+
+		count += child;
+	}
+
+	return count;
+}
+
+#define FUZZ_KEYS 5000
+#define FUZZ_OPERATIONS 100000
+
+char *test_fuzzing()
+{
+	BTree *store = BTree_create(int_compare);
+	static int present[FUZZ_KEYS] = {0};
+	BTreeIter iter;
+	void *key = NULL;
+	void *data = NULL;
+	int count = 0;
+	int i = 0;
+
+	for(i = 0; i < FUZZ_OPERATIONS; i++) {
+		intptr_t k = rand() % FUZZ_KEYS;
+
+		// every other 20000 operations delete more, so the tree shrinks back too
+		int deleting = (i / 20000) % 2 ? rand() % 3 != 0 : rand() % 4 == 0;
+
+		if(deleting) {
+			mu_assert(BTree_delete(store, (void *)k) == (present[k] ? (void *)(k + 1) : NULL),
+					"Wrong deleted data.");
+			count -= present[k];
+			present[k] = 0;
+		} else {
+			mu_assert(BTree_set(store, (void *)k, (void *)(k + 1)) == 0, "Failed to set.");
+			count += !present[k];
+			present[k] = 1;
+		}
+
+		mu_assert(store->count == count, "Wrong count.");
+
+		if(i % 1000 == 0) {
+			mu_assert(btree_check(store, store->root, 1, NULL, NULL) == count, "B+ tree rules are broken.");
+		}
+	}
+
+	// the leaf links give every key in order
+	i = 0;
+	BTree_iter_init(store, &iter);
+	while(BTree_iter_next(&iter, &key, &data)) {
+		while(!present[i]) i++;
+
+		mu_assert(key == (void *)(intptr_t)i && data == (void *)(intptr_t)(i + 1), "Wrong key in order.");
+		i++;
+	}
+
+	for(i = 0; i < FUZZ_KEYS; i++) {
+		mu_assert(BTree_get(store, (void *)(intptr_t)i) == (present[i] ? (void *)(intptr_t)(i + 1) : NULL),
+				"Wrong data.");
+
+		BTree_iter_seek(store, &iter, (void *)(intptr_t)i);
+		if(BTree_iter_next(&iter, &key, NULL)) {
+			mu_assert((intptr_t)key >= i && (key == (void *)(intptr_t)i) == present[i], "Wrong seek.");
+		}
+	}
+
+	for(i = 0; i < FUZZ_KEYS; i++) {
+		BTree_delete(store, (void *)(intptr_t)i);
+	}
+	mu_assert(store->count == 0 && store->height == 1, "Tree should shrink to a leaf.");
+
+	BTree_destroy(store);
+
+	return NULL;
+}
+
+#define FREED_KEYS 2000
+
+char *test_delete_freed_keys()
+{
+	BTree *store = BTree_create(NULL);
+	static bstring keys[FREED_KEYS] = {NULL};
+	int i = 0;
+
+	for(i = 0; i < FREED_KEYS; i++) {
+		keys[i] = bformat("key %05d", i);
+		mu_assert(BTree_set(store, keys[i], keys[i]) == 0, "Failed to set.");
+	}
+
+	// deleted keys are freed right away, the tree must not keep them
+	for(i = 0; i < FREED_KEYS; i += 2) {
+		mu_assert(BTree_delete(store, keys[i]) == keys[i], "Wrong deleted data.");
+		bdestroy(keys[i]);
+		keys[i] = NULL;
+	}
+
+	mu_assert(btree_check(store, store->root, 1, NULL, NULL) == FREED_KEYS / 2, "B+ tree rules are broken.");
+
+	for(i = 1; i < FREED_KEYS; i += 2) {
+		mu_assert(BTree_get(store, keys[i]) == keys[i], "Failed to get a key left in.");
+	}
+
+	for(i = 0; i < FREED_KEYS; i += 2) {
+		keys[i] = bformat("key %05d", i);
+		mu_assert(BTree_get(store, keys[i]) == NULL, "Deleted key is still there.");
+		mu_assert(BTree_set(store, keys[i], keys[i]) == 0, "Failed to set again.");
+	}
+
+	for(i = 0; i < FREED_KEYS; i++) {
+		mu_assert(BTree_get(store, keys[i]) == keys[i], "Failed to get.");
+		mu_assert(BTree_delete(store, keys[i]) == keys[i], "Wrong deleted data.");
+		bdestroy(keys[i]);
+	}
+
+	mu_assert(store->count == 0 && store->height == 1, "Tree should shrink to a leaf.");
+	BTree_destroy(store);
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DORDERED_KEYS=... for tens of millions of keys
+#ifndef ORDERED_KEYS
+#define ORDERED_KEYS 1000000
+#endif
+
+static int scan_cb(void *key, void *data)
+{
+	return key != data;
+}
+
+static int bstree_scan_cb(BSTreeNode *node)
+{
+	return node->key != node->data;
+}
+
+char *test_ordered_perfomance()
+{
+	struct timespec start, end;
+	intptr_t *order = calloc(ORDERED_KEYS, sizeof(intptr_t));
+	double btree_set, btree_get, btree_scan, bstree_set, bstree_get, bstree_scan;
+	int i = 0;
+	int j = 0;
+
+	mu_assert(order != NULL, "Failed to allocate keys.");
+
+	// random insert and lookup order
+	for(i = 0; i < ORDERED_KEYS; i++) {
+		order[i] = i;
+	}
+	for(i = ORDERED_KEYS - 1; i > 0; i--) {
+		j = rand() % (i + 1);
+		intptr_t temp = order[i]; order[i] = order[j]; order[j] = temp;
+	}
+
+	BTree *btree = BTree_create(int_compare);
+	BSTree *bstree = BSTree_create_balanced(int_compare);
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 0; i < ORDERED_KEYS; i++) {
+		BTree_set(btree, (void *)order[i], (void *)order[i]);
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	btree_set = (double)get_diff(start, end) / ORDERED_KEYS;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 0; i < ORDERED_KEYS; i++) {
+		BSTree_set(bstree, (void *)order[i], (void *)order[i]);
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	bstree_set = (double)get_diff(start, end) / ORDERED_KEYS;
+
+	for(i = ORDERED_KEYS - 1; i > 0; i--) {
+		j = rand() % (i + 1);
+		intptr_t temp = order[i]; order[i] = order[j]; order[j] = temp;
+	}
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 0; i < ORDERED_KEYS; i++) {
+		mu_assert(BTree_get(btree, (void *)order[i]) == (void *)order[i], "Wrong value.");
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	btree_get = (double)get_diff(start, end) / ORDERED_KEYS;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 0; i < ORDERED_KEYS; i++) {
+		mu_assert(BSTree_get(bstree, (void *)order[i]) == (void *)order[i], "Wrong value.");
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	bstree_get = (double)get_diff(start, end) / ORDERED_KEYS;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	mu_assert(BTree_traverse(btree, scan_cb) == 0, "Failed to traverse.");
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	btree_scan = (double)get_diff(start, end) / ORDERED_KEYS;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	mu_assert(BSTree_traverse(bstree, bstree_scan_cb) == 0, "Failed to traverse.");
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	bstree_scan = (double)get_diff(start, end) / ORDERED_KEYS;
+
+	printf("\nTree\t\tKeys\tHeight\tset ns\tget ns\tscan ns\n");
+	printf("BTree\t\t%d\t%d\t%.1lf\t%.1lf\t%.1lf\n", ORDERED_KEYS, btree->height, btree_set, btree_get, btree_scan);
+	printf("BSTree (red-black)\t%d\t-\t%.1lf\t%.1lf\t%.1lf\n", ORDERED_KEYS, bstree_set, bstree_get, bstree_scan);
+
+	BTree_destroy(btree);
+	BSTree_destroy(bstree);
+	free(order);
+
+	return NULL;
+}
+
+char *all_tests()
+{
+	mu_suite_start();
+
+	mu_run_test(test_create);
+	mu_run_test(test_get_set);
+	mu_run_test(test_traverse);
+	mu_run_test(test_delete);
+	mu_run_test(test_destroy);
+	mu_run_test(test_fuzzing);
+	mu_run_test(test_delete_freed_keys);
+
+	mu_run_test(test_ordered_perfomance);
+
+	return NULL;
+}
+
+RUN_TESTS(all_tests);
@@ -0,0 +1,353 @@
+#include "minunit.h"
+#include <lcthw/concurrent_hashmap.h>
+#include <lcthw/sharded_hashmap.h>
+#include <lcthw/bstrlib.h>
+#include <lcthw/tests_routines.h>
+#include <pthread.h>
+
+static ConcurrentHashmap *map = NULL;
+static int traverse_called = 0;
+struct tagbstring test1 = bsStatic("test data 1");
+struct tagbstring test2 = bsStatic("test data 2");
+struct tagbstring test3 = bsStatic("xest data 3");
+struct tagbstring expect1 = bsStatic("THE VALUE 1");
+struct tagbstring expect2 = bsStatic("THE VALUE 2");
+struct tagbstring expect3 = bsStatic("THE VALUE 3");
+
+static int traverse_good_cb(HashmapNode *node)
+{
+	debug("KEY: %s", bdata((bstring)node->key));
+	traverse_called++;
+	return 0;
+}
+
+static int traverse_fail_cb(HashmapNode *node)
+{
+	debug("KEY: %s", bdata((bstring)node->key));
+	traverse_called++;
+
+	if(traverse_called == 2) {
+		return 1;
+	} else {
+		return 0;
+	}
+}
+
+char *test_create()
+{
+	map = ConcurrentHashmap_create(NULL, NULL, 2);
+	mu_assert(map != NULL, "Failed to create map.");
+	mu_assert(map->table->buckets_number == 2, "Wrong number of buckets.");
+
+	return NULL;
+}
+
+char *test_destroy()
+{
+	ConcurrentHashmap_destroy(map);
+
+	return NULL;
+}
+
+char *test_get_set()
+{
+	int rc = ConcurrentHashmap_set(map, &test1, &expect1);
+	mu_assert(rc == 0, "Failed to set test1.");
+	mu_assert(ConcurrentHashmap_get(map, &test1) == &expect1, "Wrong value for test1.");
+
+	rc = ConcurrentHashmap_set(map, &test2, &expect2);
+	mu_assert(rc == 0, "Failed to set test2.");
+	mu_assert(ConcurrentHashmap_get(map, &test2) == &expect2, "Wrong value for test2.");
+
+	rc = ConcurrentHashmap_set(map, &test3, &expect3);
+	mu_assert(rc == 0, "Failed to set test3.");
+	mu_assert(ConcurrentHashmap_get(map, &test3) == &expect3, "Wrong value for test3.");
+
+	// the third key doesn't fit into 2 buckets
+	mu_assert(map->table->buckets_number == 4, "Map should grow.");
+	mu_assert(ConcurrentHashmap_get(map, &test1) == &expect1, "Lost test1 after growing.");
+
+	rc = ConcurrentHashmap_set(map, &test1, &expect3);
+	mu_assert(rc == 0, "Failed to replace test1.");
+	mu_assert(ConcurrentHashmap_get(map, &test1) == &expect3, "Wrong replaced value for test1.");
+	mu_assert(ConcurrentHashmap_count(map) == 3, "Replace should keep the count.");
+
+	rc = ConcurrentHashmap_set(map, &test1, &expect1);
+	mu_assert(rc == 0, "Failed to replace test1 back.");
+
+	return NULL;
+}
+
+char *test_traverse()
+{
+	int rc = ConcurrentHashmap_traverse(map, traverse_good_cb);
+	mu_assert(rc == 0, "Failed to traverse.");
+	mu_assert(traverse_called == 3, "Wrong count traverse.");
+
+	traverse_called = 0;
+	rc = ConcurrentHashmap_traverse(map, traverse_fail_cb);
+	mu_assert(rc == 1, "Failed to traverse.");
+	mu_assert(traverse_called == 2, "Wrong count traverse for fail.");
+
+	return NULL;
+}
+
+char *test_delete()
+{
+	mu_assert(ConcurrentHashmap_delete(map, &test1) == &expect1, "Should get test1.");
+	mu_assert(ConcurrentHashmap_get(map, &test1) == NULL, "Should delete.");
+	mu_assert(ConcurrentHashmap_delete(map, &test1) == NULL, "Should delete only once.");
+
+	mu_assert(ConcurrentHashmap_delete(map, &test2) == &expect2, "Should get test2.");
+	mu_assert(ConcurrentHashmap_delete(map, &test3) == &expect3, "Should get test3.");
+
+	mu_assert(ConcurrentHashmap_count(map) == 0, "Wrong count.");
+
+	// nobody reads, everything retired can go
+	ConcurrentHashmap_reclaim(map);
+	mu_assert(map->retired_nodes == NULL, "Retired nodes should be freed.");
+	mu_assert(map->retired_tables == NULL, "Retired tables should be freed.");
+
+	return NULL;
+}
+
+#define KEYS_NUMBER 10000
+
+// build with OPTFLAGS=-DSTRESS_OPERATIONS=... for longer runs
+#ifndef STRESS_OPERATIONS
+#define STRESS_OPERATIONS 200000
+#endif
+
+#define STRESS_READERS 4
+#define STRESS_WRITERS 2
+
+static bstring keys[KEYS_NUMBER] = {NULL};
+static bstring values[KEYS_NUMBER][2] = {{NULL}};
+static atomic_int writers_running = 0;
+
+typedef struct Worker {
+	pthread_t thread;
+	unsigned int seed;
+	int operations;
+	int failed;
+	ConcurrentHashmap *map;
+} Worker;
+
+static void create_keys()
+{
+	int i = 0;
+
+	for(i = 0; i < KEYS_NUMBER; i++) {
+		keys[i] = bformat("key %d", i);
+		values[i][0] = bformat("first value %d", i);
+		values[i][1] = bformat("second value %d", i);
+	}
+}
+
+static void destroy_keys()
+{
+	int i = 0;
+
+	for(i = 0; i < KEYS_NUMBER; i++) {
+		bdestroy(keys[i]);
+		bdestroy(values[i][0]);
+		bdestroy(values[i][1]);
+	}
+}
+
+static void *stress_writer(void *arg)
+{
+	Worker *worker = arg;
+	int i = 0;
+	int key = 0;
+
+	for(i = 0; i < worker->operations; i++) {
+		key = rand_r(&worker->seed) % KEYS_NUMBER;
+
+		if(rand_r(&worker->seed) % 4 == 0) {
+			ConcurrentHashmap_delete(worker->map, keys[key]);
+		} else {
+			worker->failed |= ConcurrentHashmap_set(worker->map, keys[key], values[key][i & 1]) != 0;
+		}
+	}
+
+	atomic_fetch_sub(&writers_running, 1);
+
+	return NULL;
+}
+
+static int stress_traverse_cb(HashmapNode *node)
+{
+	// reads the whole key, a freed node would show up under a sanitizer
+	return blength((bstring)node->key) == 0;
+}
+
+static void *stress_reader(void *arg)
+{
+	Worker *worker = arg;
+	bstring data = NULL;
+	int key = 0;
+	int i = 0;
+
+	while(atomic_load(&writers_running) > 0) {
+		for(i = 0; i < 1000; i++) {
+			key = rand_r(&worker->seed) % KEYS_NUMBER;
+			data = ConcurrentHashmap_get(worker->map, keys[key]);
+
+			worker->failed |= data != NULL && data != values[key][0] && data != values[key][1];
+		}
+
+		worker->failed |= ConcurrentHashmap_traverse(worker->map, stress_traverse_cb) != 0;
+	}
+
+	return NULL;
+}
+
+char *test_stress()
+{
+	Worker workers[STRESS_READERS + STRESS_WRITERS];
+	int i = 0;
+
+	ConcurrentHashmap *stressed = ConcurrentHashmap_create(NULL, NULL, 0);
+	mu_assert(stressed != NULL, "Failed to create map.");
+
+	atomic_store(&writers_running, STRESS_WRITERS);
+
+	for(i = 0; i < STRESS_READERS + STRESS_WRITERS; i++) {
+		workers[i].seed = i + 1;
+		workers[i].operations = STRESS_OPERATIONS / STRESS_WRITERS;
+		workers[i].failed = 0;
+		workers[i].map = stressed;
+
+		mu_assert(pthread_create(&workers[i].thread, NULL,
+					i < STRESS_WRITERS ? stress_writer : stress_reader, &workers[i]) == 0,
+				"Failed to start thread.");
+	}
+
+	for(i = 0; i < STRESS_READERS + STRESS_WRITERS; i++) {
+		pthread_join(workers[i].thread, NULL);
+		mu_assert(!workers[i].failed, "Wrong value under concurrent access.");
+	}
+
+	ConcurrentHashmap_destroy(stressed);
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DREAD_OPERATIONS=... for longer runs
+#ifndef READ_OPERATIONS
+#define READ_OPERATIONS 400000
+#endif
+
+typedef struct Reader {
+	pthread_t thread;
+	unsigned int seed;
+	int operations;
+	int failed;
+	ShardedHashmap *sharded;
+	ConcurrentHashmap *concurrent;
+} Reader;
+
+static void *read_run(void *arg)
+{
+	Reader *reader = arg;
+	int i = 0;
+	int key = 0;
+
+	for(i = 0; i < reader->operations; i++) {
+		key = rand_r(&reader->seed) % KEYS_NUMBER;
+
+		if(reader->sharded) {
+			reader->failed |= ShardedHashmap_get(reader->sharded, keys[key]) != values[key][0];
+		} else {
+			reader->failed |= ConcurrentHashmap_get(reader->concurrent, keys[key]) != values[key][0];
+		}
+	}
+
+	return NULL;
+}
+
+static char *run_readers(ShardedHashmap *sharded, ConcurrentHashmap *concurrent, int threads, const char *name)
+{
+	struct timespec start, end;
+	Reader readers[64];
+	int i = 0;
+
+	for(i = 0; i < threads; i++) {
+		readers[i].seed = i + 1;
+		readers[i].operations = READ_OPERATIONS / threads;
+		readers[i].failed = 0;
+		readers[i].sharded = sharded;
+		readers[i].concurrent = concurrent;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for(i = 0; i < threads; i++) {
+		mu_assert(pthread_create(&readers[i].thread, NULL, read_run, &readers[i]) == 0, "Failed to start thread.");
+	}
+
+	for(i = 0; i < threads; i++) {
+		pthread_join(readers[i].thread, NULL);
+		mu_assert(!readers[i].failed, "Wrong value under concurrent access.");
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("%s\t%d\t%lf\n", name, threads,
+			(double)(READ_OPERATIONS / threads * threads) * 1000 / get_diff(start, end));
+
+	return NULL;
+}
+
+char *test_read_scaling_perfomance()
+{
+	char *message = NULL;
+	int threads = 0;
+	int i = 0;
+
+	ShardedHashmap *sharded = ShardedHashmap_create(NULL, NULL, 64);
+	ConcurrentHashmap *concurrent = ConcurrentHashmap_create(NULL, NULL, 0);
+
+	for(i = 0; i < KEYS_NUMBER; i++) {
+		ShardedHashmap_set(sharded, keys[i], values[i][0]);
+		ConcurrentHashmap_set(concurrent, keys[i], values[i][0]);
+	}
+
+	printf("\nMap\t\tThreads\tMops/s\n");
+
+	for(threads = 1; threads <= 64; threads *= 2) {
+		message = run_readers(sharded, NULL, threads, "sharded\t");
+		if(message) return message;
+
+		message = run_readers(NULL, concurrent, threads, "concurrent");
+		if(message) return message;
+	}
+
+	ShardedHashmap_destroy(sharded);
+	ConcurrentHashmap_destroy(concurrent);
+
+	return NULL;
+}
+
+char *all_tests()
+{
+	mu_suite_start();
+
+	mu_run_test(test_create);
+	mu_run_test(test_get_set);
+	mu_run_test(test_traverse);
+	mu_run_test(test_delete);
+	mu_run_test(test_destroy);
+
+	create_keys();
+
+	mu_run_test(test_stress);
+	mu_run_test(test_read_scaling_perfomance);
+
+	destroy_keys();
+
+	return NULL;
+}
+
+RUN_TESTS(all_tests);
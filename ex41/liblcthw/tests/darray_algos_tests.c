@@ -1,5 +1,8 @@
 #include "minunit.h"
 #include <lcthw/darray_algos.h>
+#include <lcthw/darrayv.h>
+#include <lcthw/bstrlib.h>
+#include <stdint.h>
 #include <time.h>
 
 #define BILLION 1000000000UL
@@ -78,12 +81,209 @@ char *test_quicksort()
 	return run_sort_test(DArray_quicksort, "quicksort");
 }
 
+enum {
+	PATTERN_RANDOM = 0,
+	PATTERN_SORTED,
+	PATTERN_REVERSED,
+	PATTERN_EQUAL,
+	PATTERN_FEW,
+	PATTERN_ORGAN_PIPE,
+	PATTERN_COUNT
+};
+
+static const char *pattern_names[PATTERN_COUNT] = {
+	"random", "sorted", "reversed", "equal", "4 values", "organ pipe"
+};
+
+static uint32_t pattern_key(int i, int n, int pattern)
+{
+	switch(pattern) {
+		case PATTERN_SORTED: return i;
+		case PATTERN_REVERSED: return n - i;
+		case PATTERN_EQUAL: return 7;
+		case PATTERN_FEW: return rand() % 4;
+		case PATTERN_ORGAN_PIPE: return i < n / 2 ? i : n - i;
+		default: return rand();
+	}
+}
+
+static int uint32_cmp(const void *a, const void *b)
+{
+	uint32_t x = **(uint32_t **)a;
+	uint32_t y = **(uint32_t **)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int bstring_cmp(const void *a, const void *b)
+{
+	return bstrcmp(*(bstring *)a, *(bstring *)b);
+}
+
+// the order of DArray_sort_bstring
+static int bstring_bytes_cmp(const void *a, const void *b)
+{
+	bstring x = *(bstring *)a;
+	bstring y = *(bstring *)b;
+	int rc = memcmp(x->data, y->data, x->slen < y->slen ? x->slen : y->slen);
+
+	return rc != 0 ? rc : (x->slen > y->slen) - (x->slen < y->slen);
+}
+
+#define TYPED_KEYS 5000
+
+char *test_sort_typed()
+{
+	static uint32_t u32[TYPED_KEYS];
+	static uint64_t u64[TYPED_KEYS];
+	static double dbl[TYPED_KEYS];
+	int sizes[] = {0, 1, 2, 16, 17, 100, TYPED_KEYS};
+	int pattern = 0;
+	int size = 0;
+	int i = 0;
+
+	DArray *a32 = DArray_create(sizeof(uint32_t), TYPED_KEYS);
+	DArray *a64 = DArray_create(sizeof(uint64_t), TYPED_KEYS);
+	DArray *adbl = DArray_create(sizeof(double), TYPED_KEYS);
+	DArrayV *v32 = DArrayV_create(sizeof(uint32_t), TYPED_KEYS);
+	DArrayV *v64 = DArrayV_create(sizeof(uint64_t), TYPED_KEYS);
+	DArrayV *vdbl = DArrayV_create(sizeof(double), TYPED_KEYS);
+
+	for(pattern = 0; pattern < PATTERN_COUNT; pattern++) {
+		for(size = 0; size < (int)(sizeof(sizes) / sizeof(sizes[0])); size++) {
+			int n = sizes[size];
+			uint64_t sum = 0;
+			uint64_t sorted_sum = 0;
+
+			a32->end = a64->end = adbl->end = 0;
+			v32->end = v64->end = vdbl->end = 0;
+
+			for(i = 0; i < n; i++) {
+				u32[i] = pattern_key(i, n, pattern);
+				u64[i] = (uint64_t)u32[i] << 32 | (n - i);
+				dbl[i] = (double)u32[i] - n / 2;
+				sum += u32[i];
+
+				DArray_push(a32, &u32[i]);
+				DArray_push(a64, &u64[i]);
+				DArray_push(adbl, &dbl[i]);
+				DArrayV_push(v32, &u32[i]);
+				DArrayV_push(v64, &u64[i]);
+				DArrayV_push(vdbl, &dbl[i]);
+			}
+
+			mu_assert(DArray_sort_uint32(a32) == 0 && DArray_sort_uint64(a64) == 0 &&
+					DArray_sort_double(adbl) == 0, "Failed to sort.");
+			mu_assert(DArrayV_sort_uint32(v32) == 0 && DArrayV_sort_uint64(v64) == 0 &&
+					DArrayV_sort_double(vdbl) == 0, "Failed to sort.");
+
+			for(i = 0; i < n; i++) {
+				sorted_sum += *(uint32_t *)DArray_get(a32, i);
+
+				if(i == 0) continue;
+
+				mu_assert(*(uint32_t *)DArray_get(a32, i - 1) <= *(uint32_t *)DArray_get(a32, i), "uint32 isn't sorted.");
+				mu_assert(*(uint64_t *)DArray_get(a64, i - 1) <= *(uint64_t *)DArray_get(a64, i), "uint64 isn't sorted.");
+				mu_assert(*(double *)DArray_get(adbl, i - 1) <= *(double *)DArray_get(adbl, i), "double isn't sorted.");
+				mu_assert(DArrayV_at(v32, uint32_t, i - 1) <= DArrayV_at(v32, uint32_t, i), "uint32 values aren't sorted.");
+				mu_assert(DArrayV_at(v64, uint64_t, i - 1) <= DArrayV_at(v64, uint64_t, i), "uint64 values aren't sorted.");
+				mu_assert(DArrayV_at(vdbl, double, i - 1) <= DArrayV_at(vdbl, double, i), "double values aren't sorted.");
+				mu_assert(DArrayV_at(v32, uint32_t, i) == *(uint32_t *)DArray_get(a32, i), "Sorts differ.");
+			}
+
+			mu_assert(sum == sorted_sum, "Sort lost keys.");
+		}
+	}
+
+	mu_assert(DArrayV_sort_uint64(v32) == -1, "Should fail on the wrong element size.");
+
+	DArray_destroy(a32);
+	DArray_destroy(a64);
+	DArray_destroy(adbl);
+	DArrayV_destroy(v32);
+	DArrayV_destroy(v64);
+	DArrayV_destroy(vdbl);
+
+	return NULL;
+}
+
+#define PATTERN_KEYS 20000
+
+char *test_sort_patterns()
+{
+	static uint32_t values[PATTERN_KEYS];
+	int (*sorts[])(DArray *, DArray_compare) = {DArray_quicksort, DArray_heapsort};
+	DArray *keys = DArray_create(sizeof(uint32_t), PATTERN_KEYS);
+	int pattern = 0;
+	int sort = 0;
+	int i = 0;
+
+	for(pattern = 0; pattern < PATTERN_COUNT; pattern++) {
+		for(sort = 0; sort < 2; sort++) {
+			uint64_t sum = 0;
+
+			keys->end = 0;
+			for(i = 0; i < PATTERN_KEYS; i++) {
+				values[i] = pattern_key(i, PATTERN_KEYS, pattern);
+				sum += values[i];
+				DArray_push(keys, &values[i]);
+			}
+
+			mu_assert(sorts[sort](keys, uint32_cmp) == 0, "Failed to sort.");
+
+			for(i = 0; i < PATTERN_KEYS; i++) {
+				sum -= *(uint32_t *)DArray_get(keys, i);
+				mu_assert(i == 0 || *(uint32_t *)DArray_get(keys, i - 1) <= *(uint32_t *)DArray_get(keys, i),
+						"Pattern isn't sorted.");
+			}
+			mu_assert(sum == 0, "Sort lost keys.");
+		}
+	}
+
+	DArray_destroy(keys);
+
+	return NULL;
+}
+
+#define BSTRING_KEYS 2000
+
+char *test_sort_bstring()
+{
+	DArray *strings = DArray_create(sizeof(bstring), BSTRING_KEYS);
+	DArray *expect = DArray_create(sizeof(bstring), BSTRING_KEYS);
+	int i = 0;
+
+	// shared prefixes, prefixes of each other and bytes over 127
+	for(i = 0; i < BSTRING_KEYS; i++) {
+		bstring key = bformat("%c%d", i % 3 ? 'k' : 0xe9, rand() % 500);
+		if(i % 5 == 0) bconchar(key, '\0');
+
+		DArray_push(strings, key);
+		DArray_push(expect, key);
+	}
+
+	DArray_qsort(expect, bstring_bytes_cmp);
+	mu_assert(DArray_sort_bstring(strings) == 0, "Failed to sort.");
+
+	for(i = 0; i < BSTRING_KEYS; i++) {
+		mu_assert(bstring_bytes_cmp(&strings->contents[i], &expect->contents[i]) == 0, "Wrong byte order.");
+	}
+
+	for(i = 0; i < BSTRING_KEYS; i++) {
+		bdestroy(DArray_get(strings, i));
+	}
+	DArray_destroy(strings);
+	DArray_destroy(expect);
+
+	return NULL;
+}
+
 char *test_algo_perfomance(int (*func)(DArray *, DArray_compare), const char *name)
 {
 	struct timespec start, end;
 	double diff;
 
-	DArray *arrays[ARRAYS_COUNT] = {NULL};
+	static DArray *arrays[ARRAYS_COUNT] = {NULL};
 
 	int i = 0;
 
@@ -130,6 +330,223 @@ char *test_quicksort_perfomance()
 	return test_algo_perfomance(DArray_quicksort, "quicksort (custom)");
 }
 
+// build with OPTFLAGS=-DTYPED_BENCH_KEYS=... for other sizes
+#ifndef TYPED_BENCH_KEYS
+#define TYPED_BENCH_KEYS 1000000
+#endif
+
+static int sort_uint32_kernel(DArray *array, DArray_compare cmp)
+{
+	(void)cmp;
+	return DArray_sort_uint32(array);
+}
+
+static int sort_bstring_kernel(DArray *array, DArray_compare cmp)
+{
+	(void)cmp;
+	return DArray_sort_bstring(array);
+}
+
+// ns per key to sort a copy of the first 'n' of 'keys'
+static double time_sort(DArray *keys, int n, int (*func)(DArray *, DArray_compare), DArray_compare cmp)
+{
+	struct timespec start, end;
+	DArray *work = DArray_create(sizeof(void *), n);
+
+	memcpy(work->contents, keys->contents, n * sizeof(void *));
+	work->end = n;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	func(work, cmp);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+	DArray_destroy(work);
+
+	return (double)get_diff(start, end) / n;
+}
+
+char *test_typed_sort_perfomance()
+{
+	struct timespec start, end;
+	uint32_t *values = calloc(TYPED_BENCH_KEYS, sizeof(uint32_t));
+	DArray *keys = DArray_create(sizeof(uint32_t), TYPED_BENCH_KEYS);
+	DArray *strings = DArray_create(sizeof(bstring), TYPED_BENCH_KEYS);
+	DArrayV *by_value = DArrayV_create(sizeof(uint32_t), TYPED_BENCH_KEYS);
+	int i = 0;
+
+	mu_assert(values != NULL && keys != NULL && strings != NULL && by_value != NULL, "Failed to allocate keys.");
+
+	for(i = 0; i < TYPED_BENCH_KEYS; i++) {
+		values[i] = rand();
+		DArray_push(keys, &values[i]);
+		DArray_push(strings, bformat("key-%u", values[i]));
+	}
+
+	printf("\n%d random keys, ns per key\n", TYPED_BENCH_KEYS);
+	printf("Algorithm\t\t\tuint32\tbstring\n");
+	printf("qsort (original)\t\t%.2lf\t%.2lf\n",
+			time_sort(keys, TYPED_BENCH_KEYS, DArray_qsort, uint32_cmp),
+			time_sort(strings, TYPED_BENCH_KEYS, DArray_qsort, bstring_cmp));
+	printf("heapsort (custom)\t\t%.2lf\t%.2lf\n",
+			time_sort(keys, TYPED_BENCH_KEYS, DArray_heapsort, uint32_cmp),
+			time_sort(strings, TYPED_BENCH_KEYS, DArray_heapsort, bstring_cmp));
+	printf("mergesort (custom)\t\t%.2lf\t%.2lf\n",
+			time_sort(keys, TYPED_BENCH_KEYS, DArray_mergesort, uint32_cmp),
+			time_sort(strings, TYPED_BENCH_KEYS, DArray_mergesort, bstring_cmp));
+	printf("quicksort (custom)\t\t%.2lf\t%.2lf\n",
+			time_sort(keys, TYPED_BENCH_KEYS, DArray_quicksort, uint32_cmp),
+			time_sort(strings, TYPED_BENCH_KEYS, DArray_quicksort, bstring_cmp));
+	printf("DArray_sort_<type>\t\t%.2lf\t%.2lf\n",
+			time_sort(keys, TYPED_BENCH_KEYS, sort_uint32_kernel, NULL),
+			time_sort(strings, TYPED_BENCH_KEYS, sort_bstring_kernel, NULL));
+
+	for(i = 0; i < TYPED_BENCH_KEYS; i++) {
+		DArrayV_push(by_value, &values[i]);
+	}
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	DArrayV_sort_uint32(by_value);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+	printf("DArrayV_sort_uint32\t\t%.2lf\t-\n", (double)get_diff(start, end) / TYPED_BENCH_KEYS);
+
+	for(i = 1; i < TYPED_BENCH_KEYS; i++) {
+		mu_assert(DArrayV_at(by_value, uint32_t, i - 1) <= DArrayV_at(by_value, uint32_t, i), "Not sorted.");
+	}
+
+	for(i = 0; i < TYPED_BENCH_KEYS; i++) {
+		bdestroy(DArray_get(strings, i));
+	}
+	DArray_destroy(strings);
+	DArray_destroy(keys);
+	DArrayV_destroy(by_value);
+	free(values);
+
+	return NULL;
+}
+
+#define HEAP_KEYS 5000
+
+char *test_heap()
+{
+	static uint32_t values[HEAP_KEYS];
+	DArray *heap = DArray_create(sizeof(uint32_t), 16);
+	uint32_t *top = NULL;
+	uint32_t last = 0;
+	int i = 0;
+
+	mu_assert(DArray_heap_peek(heap) == NULL, "Empty heap should have no top.");
+	mu_assert(DArray_heap_pop(heap, uint32_cmp) == NULL, "Should fail to pop from empty heap.");
+
+	for(i = 0; i < HEAP_KEYS; i++) {
+		values[i] = rand() % 1000;
+		mu_assert(DArray_heap_push(heap, &values[i], uint32_cmp) == 0, "Failed to push.");
+
+		top = DArray_heap_peek(heap);
+		mu_assert(top != NULL && (i == 0 || *top <= last), "Wrong top after push.");
+		last = *top;
+	}
+
+	// pops come in order, every value once
+	for(i = 0, last = 0; i < HEAP_KEYS; i++) {
+		top = DArray_heap_pop(heap, uint32_cmp);
+		mu_assert(top != NULL && *top >= last, "Wrong pop order.");
+		last = *top;
+		*top = 1000;
+	}
+	mu_assert(DArray_count(heap) == 0, "Heap should be empty.");
+
+	for(i = 0; i < HEAP_KEYS; i++) {
+		mu_assert(values[i] == 1000, "Value popped twice or never.");
+		values[i] = HEAP_KEYS - i;
+		DArray_push(heap, &values[i]);
+	}
+
+	mu_assert(DArray_heapify(heap, uint32_cmp) == 0, "Failed to heapify.");
+	for(i = 1; i <= HEAP_KEYS; i++) {
+		top = DArray_heap_pop(heap, uint32_cmp);
+		mu_assert(top != NULL && *top == (uint32_t)i, "Wrong pop after heapify.");
+	}
+
+	DArray_destroy(heap);
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DHEAPSORT_BENCH_KEYS=... for bigger runs
+#ifndef HEAPSORT_BENCH_KEYS
+#define HEAPSORT_BENCH_KEYS 4096000
+#endif
+
+char *test_heapsort_scaling_perfomance()
+{
+	uint32_t *values = calloc(HEAPSORT_BENCH_KEYS, sizeof(uint32_t));
+	DArray *keys = DArray_create(sizeof(uint32_t), HEAPSORT_BENCH_KEYS);
+	double diff = 0;
+	int log2n = 0;
+	int n = 0;
+	int i = 0;
+
+	mu_assert(values != NULL && keys != NULL, "Failed to allocate keys.");
+
+	for(i = 0; i < HEAPSORT_BENCH_KEYS; i++) {
+		values[i] = rand();
+		DArray_push(keys, &values[i]);
+	}
+
+	// n log n time keeps the last column flat, n^2 log n would grow it n times
+	printf("\nKeys\t\theapsort ns per key\tns per key and log2(n)\n");
+
+	for(n = 1000; n <= HEAPSORT_BENCH_KEYS; n *= 4) {
+		for(log2n = 0, i = n; i > 1; i >>= 1) log2n++;
+
+		diff = time_sort(keys, n, DArray_heapsort, uint32_cmp);
+		printf("%d\t\t%.2lf\t\t\t%.2lf\n", n, diff, diff / log2n);
+	}
+
+	DArray_destroy(keys);
+	free(values);
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DPATTERN_BENCH_KEYS=... for other sizes
+#ifndef PATTERN_BENCH_KEYS
+#define PATTERN_BENCH_KEYS 1000000
+#endif
+
+char *test_pattern_perfomance()
+{
+	uint32_t *values = calloc(PATTERN_BENCH_KEYS, sizeof(uint32_t));
+	DArray *keys = DArray_create(sizeof(uint32_t), PATTERN_BENCH_KEYS);
+	int pattern = 0;
+	int i = 0;
+
+	mu_assert(values != NULL && keys != NULL, "Failed to allocate keys.");
+
+	printf("\n%d keys, ns per key\n", PATTERN_BENCH_KEYS);
+	printf("Input\t\tqsort\theapsort\tquicksort\tDArray_sort_uint32\n");
+
+	for(pattern = 0; pattern < PATTERN_COUNT; pattern++) {
+		keys->end = 0;
+		for(i = 0; i < PATTERN_BENCH_KEYS; i++) {
+			values[i] = pattern_key(i, PATTERN_BENCH_KEYS, pattern);
+			DArray_push(keys, &values[i]);
+		}
+
+		printf("%-10s\t%.2lf\t%.2lf\t\t%.2lf\t\t%.2lf\n", pattern_names[pattern],
+				time_sort(keys, PATTERN_BENCH_KEYS, DArray_qsort, uint32_cmp),
+				time_sort(keys, PATTERN_BENCH_KEYS, DArray_heapsort, uint32_cmp),
+				time_sort(keys, PATTERN_BENCH_KEYS, DArray_quicksort, uint32_cmp),
+				time_sort(keys, PATTERN_BENCH_KEYS, sort_uint32_kernel, NULL));
+	}
+
+	DArray_destroy(keys);
+	free(values);
+
+	return NULL;
+}
+
 char *all_tests()
 {
 	mu_suite_start();
@@ -138,11 +555,18 @@ char *all_tests()
 	mu_run_test(test_heapsort);
 	mu_run_test(test_mergesort);
 	mu_run_test(test_quicksort);
+	mu_run_test(test_sort_typed);
+	mu_run_test(test_sort_bstring);
+	mu_run_test(test_sort_patterns);
+	mu_run_test(test_heap);
 
 	mu_run_test(test_qsort_perfomance);
 	mu_run_test(test_heapsort_perfomance);
 	mu_run_test(test_mergesort_perfomance);
 	mu_run_test(test_quicksort_perfomance);
+	mu_run_test(test_typed_sort_perfomance);
+	mu_run_test(test_heapsort_scaling_perfomance);
+	mu_run_test(test_pattern_perfomance);
 
 	return NULL;
 }
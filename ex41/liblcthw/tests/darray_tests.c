@@ -110,7 +110,8 @@ char *test_push_pop()
 		DArray_push(array, val);
 	}
 
-	mu_assert(array->max == 1201, "Wrong max size.");
+	// 301 doubled twice
+	mu_assert(array->max == 1204, "Wrong max size.");
 
 	for(i = 999; i >= 0; i--) {
 		int *val = DArray_pop(array);
@@ -119,6 +120,52 @@ char *test_push_pop()
 		DArray_free(val);
 	}
 
+	mu_assert(array->max == 301, "Pop should shrink back to the expand_rate.");
+
+	return NULL;
+}
+
+char *test_reserve_shrink()
+{
+	DArray *darr = DArray_create(sizeof(int), 10);
+	char c = 'c';
+	int max = 0;
+	int i = 0;
+
+	mu_assert(DArray_reserve(darr, 5000) == 0, "Failed to reserve.");
+	mu_assert(darr->max == 5000, "Wrong max after reserve.");
+	mu_assert(DArray_reserve(darr, 100) == 0 && darr->max == 5000, "Reserve shouldn't shrink.");
+	mu_assert(DArray_reserve(darr, -1) == -1, "Should fail on a negative count.");
+
+	for(i = 0; i < 5000; i++) {
+		DArray_push(darr, &c);
+	}
+	mu_assert(darr->max == 5000, "Reserved pushes shouldn't expand.");
+
+	// pushes and pops around a boundary only realloc once
+	DArray_push(darr, &c);
+	max = darr->max;
+	mu_assert(max == 10000, "Wrong max after growth.");
+	mu_assert(darr->contents[5001] == NULL, "New slots should be zeroed.");
+
+	for(i = 0; i < 1000; i++) {
+		DArray_pop(darr);
+		DArray_push(darr, &c);
+		mu_assert(darr->max == max, "Push and pop near a boundary shouldn't resize.");
+	}
+
+	// down to 3001 of 10000, more than a quarter
+	for(i = 0; i < 2000; i++) {
+		DArray_pop(darr);
+	}
+	mu_assert(darr->max == max, "Less than half full shouldn't shrink yet.");
+
+	mu_assert(DArray_shrink_to_fit(darr) == 0, "Failed to shrink.");
+	mu_assert(darr->max == DArray_end(darr), "Wrong max after shrink to fit.");
+	mu_assert(DArray_pop(darr) == &c && DArray_end(darr) == 3000, "Wrong pop after shrink to fit.");
+
+	DArray_destroy(darr);
+
 	return NULL;
 }
 
@@ -145,6 +192,58 @@ char *test_darray_push_perfomance()
 	return NULL;
 }
 
+// build with OPTFLAGS=-DGROWTH_MAX_ITER=100000000L to get the 10^7 and 10^8 rows
+#ifndef GROWTH_MAX_ITER
+#define GROWTH_MAX_ITER			1000000L
+#endif
+
+#define GROWTH_ROUND_ITER		10000000L
+
+char *test_darray_growth_perfomance()
+{
+	struct timespec start, end;
+	double push_diff, pop_diff;
+	long n = 0;
+	long i = 0;
+	long round = 0;
+	long rounds = 0;
+	char c = 'c';
+
+	printf("\nDArray from one slot\tpush ns\tpop ns\tmax\n");
+
+	for(n = 1000; n <= GROWTH_MAX_ITER; n *= 10) {
+		// small sizes are repeated to time as many elements
+		rounds = n < GROWTH_ROUND_ITER ? GROWTH_ROUND_ITER / n : 1;
+		push_diff = pop_diff = 0;
+		int max = 0;
+
+		for(round = 0; round < rounds; round++) {
+			DArray *darr = DArray_create(sizeof(char), 1);
+
+			clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+			for(i = 0; i < n; i++) {
+				DArray_push(darr, &c);
+			}
+			clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+			push_diff += get_diff(start, end);
+			max = DArray_max(darr);
+
+			clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+			for(i = 0; i < n; i++) {
+				mu_assert(DArray_pop(darr) == &c, "Wrong popped value.");
+			}
+			clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+			pop_diff += get_diff(start, end);
+
+			DArray_destroy(darr);
+		}
+
+		printf("%-20ld\t%.2lf\t%.2lf\t%d\n", n, push_diff / (n * rounds), pop_diff / (n * rounds), max);
+	}
+
+	return NULL;
+}
+
 char *test_list_push_perfomance()
 {
 	struct timespec start, end;
@@ -255,7 +354,7 @@ char *test_list_remove_perfomance()
 	double diff;
 	int i = 0;
 	char c = 'c';
-	ListNode *node_addresses[LIST_REMOVE_ITER] = {NULL};
+	static ListNode *node_addresses[LIST_REMOVE_ITER] = {NULL};
 	char *removed = NULL;
 
 	List *list = List_create();
@@ -396,6 +495,7 @@ char *all_tests() {
 	mu_run_test(test_remove);
 	mu_run_test(test_expand_contract);
 	mu_run_test(test_push_pop);
+	mu_run_test(test_reserve_shrink);
 	mu_run_test(test_destroy);
 
 	srand(time(NULL));
@@ -405,6 +505,7 @@ char *all_tests() {
 
 	mu_run_test(test_darray_push_perfomance);
 	mu_run_test(test_list_push_perfomance);
+	mu_run_test(test_darray_growth_perfomance);
 	mu_run_test(test_darray_pop_perfomance);
 	mu_run_test(test_list_pop_perfomance);
 	mu_run_test(test_darray_remove_perfomance);
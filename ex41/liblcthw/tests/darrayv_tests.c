@@ -0,0 +1,270 @@
+#include "minunit.h"
+#include <lcthw/darrayv.h>
+#include <lcthw/darray_algos.h>
+#include <lcthw/tests_routines.h>
+#include <stdint.h>
+#include <time.h>
+
+// the 16 byte records the by-value array is for
+typedef struct Record {
+	uint64_t key;
+	uint32_t count;
+	uint32_t flags;
+} Record;
+
+static DArrayV *array = NULL;
+
+static int record_cmp(const void *a, const void *b)
+{
+	uint64_t x = ((const Record *)a)->key;
+	uint64_t y = ((const Record *)b)->key;
+
+	return x < y ? -1 : x > y;
+}
+
+// DArray sorts pointers to the elements
+static int record_ptr_cmp(const void *a, const void *b)
+{
+	return record_cmp(*(Record * const *)a, *(Record * const *)b);
+}
+
+char *test_create()
+{
+	array = DArrayV_create(sizeof(Record), 100);
+	mu_assert(array != NULL, "DArrayV_create failed.");
+	mu_assert(array->contents != NULL, "contents are wrong in darrayv");
+	mu_assert(array->end == 0, "end isn't at the right spot");
+	mu_assert(array->element_size == sizeof(Record), "element size is wrong.");
+	mu_assert(array->max == 100, "wrong max length on initial size");
+
+	mu_assert(DArrayV_create(0, 100) == NULL, "Should fail on 0 element size.");
+
+	return NULL;
+}
+
+char *test_destroy()
+{
+	DArrayV_destroy(array);
+
+	return NULL;
+}
+
+char *test_push_get_set()
+{
+	Record record = {.key = 7, .count = 1, .flags = 2};
+	Record *el = NULL;
+
+	mu_assert(DArrayV_push(array, &record) == 0, "Failed to push.");
+
+	// the array keeps a copy
+	record.key = 8;
+	el = DArrayV_get(array, 0);
+	mu_assert(el != NULL && el->key == 7 && el->count == 1 && el->flags == 2, "Wrong pushed value.");
+
+	el = DArrayV_new(array);
+	mu_assert(el != NULL && el->key == 0 && el->count == 0, "New element should be zeroed.");
+	el->key = 9;
+	mu_assert(DArrayV_at(array, Record, 1).key == 9, "Wrong element filled in place.");
+
+	DArrayV_set(array, 0, &record);
+	mu_assert(DArrayV_at(array, Record, 0).key == 8, "Wrong set value.");
+	mu_assert(((Record *)DArrayV_last(array))->key == 9, "Wrong last.");
+	mu_assert(((Record *)DArrayV_first(array))->key == 8, "Wrong first.");
+
+	mu_assert(DArrayV_get(array, 2) == NULL, "Should fail to get past end.");
+	mu_assert(DArrayV_count(array) == 2, "Wrong count.");
+
+	return NULL;
+}
+
+char *test_push_pop()
+{
+	Record record = {0};
+	int i = 0;
+
+	for(i = 0; i < 1000; i++) {
+		record.key = i * 333;
+		record.count = i;
+		mu_assert(DArrayV_push(array, &record) == 0, "Failed to push.");
+	}
+
+	// 100 grown by the expand_rate, then doubled twice
+	mu_assert(array->max == 1600, "Wrong max size.");
+
+	for(i = 999; i >= 0; i--) {
+		mu_assert(DArrayV_pop(array, &record) == 0, "Failed to pop.");
+		mu_assert(record.key == (uint64_t)i * 333 && record.count == (uint32_t)i, "Wrong value.");
+	}
+
+	mu_assert(DArrayV_pop(array, NULL) == -1, "Should fail to pop from empty array.");
+	mu_assert(array->max == 400, "Pop should shrink.");
+
+	mu_assert(DArrayV_reserve(array, 5000) == 0 && array->max == 5000, "Failed to reserve.");
+	mu_assert(DArrayV_shrink_to_fit(array) == 0 && array->max == 1, "Failed to shrink to fit.");
+
+	return NULL;
+}
+
+#define SORT_RECORDS 1000
+
+char *test_sort_find()
+{
+	DArrayV *records = DArrayV_create(sizeof(Record), 16);
+	Record record = {0};
+	int i = 0;
+
+	for(i = 0; i < SORT_RECORDS; i++) {
+		record.key = rand() % (SORT_RECORDS * 10);
+		record.count = i;
+		DArrayV_push(records, &record);
+	}
+
+	mu_assert(DArrayV_sort(records, record_cmp) == 0, "Failed to sort.");
+
+	for(i = 0; i < SORT_RECORDS - 1; i++) {
+		mu_assert(DArrayV_at(records, Record, i).key <= DArrayV_at(records, Record, i + 1).key, "Not sorted.");
+	}
+
+	for(i = 0; i < SORT_RECORDS; i++) {
+		record = DArrayV_at(records, Record, i);
+
+		int found = DArrayV_find(records, &record, record_cmp);
+		mu_assert(found >= 0 && DArrayV_at(records, Record, found).key == record.key, "Failed to find.");
+	}
+
+	record.key = SORT_RECORDS * 10;
+	mu_assert(DArrayV_find(records, &record, record_cmp) == -1, "Shouldn't find a missing key.");
+
+	DArrayV_destroy(records);
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DSCAN_RECORDS=... for other sizes
+#ifndef SCAN_RECORDS
+#define SCAN_RECORDS 4000000
+#endif
+
+#define SCAN_ROUNDS 10
+
+static uint64_t scan_darray(DArray *records)
+{
+	uint64_t sum = 0;
+	int i = 0;
+
+	for(i = 0; i < DArray_count(records); i++) {
+		Record *record = DArray_get(records, i);
+		sum += record->key + record->count;
+	}
+
+	return sum;
+}
+
+static uint64_t scan_darrayv(DArrayV *records)
+{
+	uint64_t sum = 0;
+	int i = 0;
+
+	for(i = 0; i < DArrayV_count(records); i++) {
+		Record *record = &DArrayV_at(records, Record, i);
+		sum += record->key + record->count;
+	}
+
+	return sum;
+}
+
+char *test_scan_sort_perfomance()
+{
+	struct timespec start, end;
+	double pointers_scan, shuffled_scan, values_scan, pointers_sort, values_sort;
+	uint64_t expect = 0;
+	int round = 0;
+	int i = 0;
+	int j = 0;
+
+	DArray *pointers = DArray_create(sizeof(Record), SCAN_RECORDS);
+	DArrayV *values = DArrayV_create(sizeof(Record), SCAN_RECORDS);
+	mu_assert(pointers != NULL && values != NULL, "Failed to create arrays.");
+
+	for(i = 0; i < SCAN_RECORDS; i++) {
+		Record *record = DArray_new(pointers);
+		record->key = ((uint64_t)rand() << 31) ^ rand();
+		record->count = i;
+		DArray_push(pointers, record);
+		DArrayV_push(values, record);
+		expect += record->key + record->count;
+	}
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(round = 0; round < SCAN_ROUNDS; round++) {
+		mu_assert(scan_darray(pointers) == expect, "Wrong DArray sum.");
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	pointers_scan = (double)get_diff(start, end) / ((double)SCAN_ROUNDS * SCAN_RECORDS);
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(round = 0; round < SCAN_ROUNDS; round++) {
+		mu_assert(scan_darrayv(values) == expect, "Wrong DArrayV sum.");
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	values_scan = (double)get_diff(start, end) / ((double)SCAN_ROUNDS * SCAN_RECORDS);
+
+	// a long lived array ends up pointing all over the heap
+	for(i = SCAN_RECORDS - 1; i > 0; i--) {
+		j = rand() % (i + 1);
+		void *temp = pointers->contents[i]; pointers->contents[i] = pointers->contents[j]; pointers->contents[j] = temp;
+	}
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(round = 0; round < SCAN_ROUNDS; round++) {
+		mu_assert(scan_darray(pointers) == expect, "Wrong DArray sum.");
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	shuffled_scan = (double)get_diff(start, end) / ((double)SCAN_ROUNDS * SCAN_RECORDS);
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	DArray_qsort(pointers, record_ptr_cmp);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	pointers_sort = (double)get_diff(start, end) / SCAN_RECORDS;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	DArrayV_sort(values, record_cmp);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	values_sort = (double)get_diff(start, end) / SCAN_RECORDS;
+
+	for(i = 0; i < SCAN_RECORDS; i++) {
+		mu_assert(((Record *)DArray_get(pointers, i))->key == DArrayV_at(values, Record, i).key, "Sorts differ.");
+	}
+
+	printf("\n%d records of %zu bytes, ns per record\n", SCAN_RECORDS, sizeof(Record));
+	printf("Array\t\t\tscan\tsort\n");
+	printf("DArray\t\t\t%.2lf\t-\n", pointers_scan);
+	printf("DArray (shuffled)\t%.2lf\t%.2lf\n", shuffled_scan, pointers_sort);
+	printf("DArrayV\t\t\t%.2lf\t%.2lf\n", values_scan, values_sort);
+
+	DArray_clear_destroy(pointers);
+	DArrayV_destroy(values);
+
+	return NULL;
+}
+
+char *all_tests()
+{
+	mu_suite_start();
+
+	mu_run_test(test_create);
+	mu_run_test(test_push_get_set);
+	mu_run_test(test_destroy);
+
+	mu_run_test(test_create);
+	mu_run_test(test_push_pop);
+	mu_run_test(test_destroy);
+
+	mu_run_test(test_sort_find);
+
+	mu_run_test(test_scan_sort_perfomance);
+
+	return NULL;
+}
+
+RUN_TESTS(all_tests);
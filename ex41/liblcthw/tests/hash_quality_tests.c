@@ -0,0 +1,387 @@
+#include <lcthw/bstrlib.h>
+#include <lcthw/hashmap.h>
+#include <lcthw/hashmap_algos.h>
+#include <lcthw/darray.h>
+#include <lcthw/tests_routines.h>
+#include "minunit.h"
+#include <string.h>
+
+/*
+ * Hash quality and speed over a few key corpora, one CSV row for every
+ * hash and corpus:
+ *
+ *   chi2_per_bucket  chi-squared of the low QUALITY_BUCKETS_BITS bits
+ *                    (what a power of two map uses) over its degrees
+ *                    of freedom, about 1 for a uniform hash
+ *   avalanche_mean   mean and worst |2P - 1|, where P is the chance an
+ *   avalanche_worst  output bit flips when one of the first 64 input
+ *                    bits flips, 0 is ideal
+ *   collisions       equal 32 bit hashes, 'expected' is the number a
+ *                    random function gives for this many keys
+ *   ns_per_key       hashing time
+ */
+
+#ifndef QUALITY_KEYS
+#define QUALITY_KEYS 100000
+#endif
+
+// kept out of the tree, build with OPTFLAGS=-DQUALITY_CSV=... to keep it elsewhere
+#ifndef QUALITY_CSV
+#define QUALITY_CSV "/tmp/hash_quality.csv"
+#endif
+
+// used instead of the generated words when it can be read
+#ifndef QUALITY_WORDS_FILE
+#define QUALITY_WORDS_FILE "/usr/share/dict/words"
+#endif
+
+#define QUALITY_BUCKETS_BITS 10
+#define QUALITY_BUCKETS (1 << QUALITY_BUCKETS_BITS)
+#define AVALANCHE_KEYS 1000
+#define AVALANCHE_BITS 64
+#define TIMING_ROUNDS 4
+
+// thresholds a hash has to pass on every corpus to be picked as a default
+#define MAX_CHI2_PER_BUCKET 1.5
+#define MAX_AVALANCHE_WORST 0.25
+#define MAX_COLLISIONS(E) (4 * (E) + 8)
+
+typedef struct QualityResult {
+	double chi2_per_bucket;
+	double avalanche_mean;
+	double avalanche_worst;
+	int collisions;
+	double expected_collisions;
+	double ns_per_key;
+} QualityResult;
+
+static const uint64_t QUALITY_SEED[2] = {0x0123456789abcdefULL, 0xfedcba9876543210ULL};
+
+static uint32_t seeded_siphash(void *data)
+{
+	return Hashmap_siphash(data, QUALITY_SEED);
+}
+
+static struct {
+	const char *name;
+	Hashmap_hash hash;
+} hashes[] = {
+	{"fnv1a", Hashmap_fnv1a_hash},
+	{"adler32", Hashmap_adler32_hash},
+	{"djb", Hashmap_djb_hash},
+	{"default", default_hash},
+	{"loselose", Hashmap_loselose_hash},
+	{"sdbm", Hashmap_sdbm_hash},
+	{"wy", Hashmap_wy_hash},
+	{"adler32_simd", Hashmap_adler32_simd_hash},
+	{"siphash", seeded_siphash}
+};
+
+#define HASHES_NUMBER (int)(sizeof(hashes) / sizeof(hashes[0]))
+
+static int hash_index(const char *name)
+{
+	int h = 0;
+
+	for(h = 0; h < HASHES_NUMBER; h++) {
+		if(strcmp(hashes[h].name, name) == 0) return h;
+	}
+
+	return -1;
+}
+
+static DArray *integer_keys()
+{
+	int i = 0;
+	DArray *keys = DArray_create(sizeof(bstring), QUALITY_KEYS);
+
+	for(i = 0; i < QUALITY_KEYS; i++) {
+		DArray_push(keys, bformat("%d", i));
+	}
+
+	return keys;
+}
+
+static const char *syllables[] = {
+	"ka", "lo", "mi", "ne", "ru", "sa", "te", "vi", "an", "or",
+	"el", "is", "un", "tra", "pre", "con", "ing", "tion", "er", "st"
+};
+
+#define SYLLABLES_NUMBER (int)(sizeof(syllables) / sizeof(syllables[0]))
+
+// words from a dictionary file or made of syllables, every one different
+static DArray *word_keys()
+{
+	char line[256];
+	int i = 0;
+	int n = 0;
+	DArray *keys = DArray_create(sizeof(bstring), QUALITY_KEYS);
+	FILE *words = fopen(QUALITY_WORDS_FILE, "r");
+
+	if(words) {
+		while(DArray_count(keys) < QUALITY_KEYS && fgets(line, sizeof(line), words)) {
+			line[strcspn(line, "\r\n")] = '\0';
+			if(line[0] != '\0') DArray_push(keys, bfromcstr(line));
+		}
+		fclose(words);
+	}
+
+	// the number written in syllables instead of digits
+	for(i = DArray_count(keys); i < QUALITY_KEYS; i++) {
+		bstring word = bfromcstr("");
+
+		for(n = i; n > 0 || blength(word) == 0; n /= SYLLABLES_NUMBER) {
+			bcatcstr(word, syllables[n % SYLLABLES_NUMBER]);
+		}
+		DArray_push(keys, word);
+	}
+
+	return keys;
+}
+
+static DArray *url_keys()
+{
+	int i = 0;
+	DArray *keys = DArray_create(sizeof(bstring), QUALITY_KEYS);
+
+	for(i = 0; i < QUALITY_KEYS; i++) {
+		DArray_push(keys, bformat("https://www.%s%s.com/%s/%s/item?id=%d&page=%d",
+					syllables[rand() % SYLLABLES_NUMBER], syllables[i % 7],
+					syllables[rand() % SYLLABLES_NUMBER], syllables[(i / 7) % SYLLABLES_NUMBER],
+					rand() % 100000, i % 50));
+	}
+
+	return keys;
+}
+
+static DArray *random_keys()
+{
+	char buffer[20];
+	int i = 0;
+	int j = 0;
+	DArray *keys = DArray_create(sizeof(bstring), QUALITY_KEYS);
+
+	for(i = 0; i < QUALITY_KEYS; i++) {
+		for(j = 0; j < (int)sizeof(buffer); j++) {
+			buffer[j] = rand();
+		}
+		DArray_push(keys, blk2bstr(buffer, sizeof(buffer)));
+	}
+
+	return keys;
+}
+
+static void destroy_corpus(DArray *keys)
+{
+	int i = 0;
+
+	for(i = 0; i < DArray_count(keys); i++) {
+		bdestroy(DArray_get(keys, i));
+	}
+
+	DArray_destroy(keys);
+}
+
+static int uint32_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(uint32_t *)a;
+	uint32_t y = *(uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void measure_distribution(Hashmap_hash hash, DArray *keys, QualityResult *result)
+{
+	int buckets[QUALITY_BUCKETS] = {0};
+	int count = DArray_count(keys);
+	uint32_t *values = calloc(count, sizeof(uint32_t));
+	double expected = (double)count / QUALITY_BUCKETS;
+	int i = 0;
+
+	for(i = 0; i < count; i++) {
+		values[i] = hash(DArray_get(keys, i));
+		buckets[values[i] & (QUALITY_BUCKETS - 1)]++;
+	}
+
+	result->chi2_per_bucket = 0;
+	for(i = 0; i < QUALITY_BUCKETS; i++) {
+		result->chi2_per_bucket += (buckets[i] - expected) * (buckets[i] - expected) / expected;
+	}
+	result->chi2_per_bucket /= QUALITY_BUCKETS - 1;
+
+	qsort(values, count, sizeof(uint32_t), uint32_cmp);
+
+	result->collisions = 0;
+	for(i = 1; i < count; i++) {
+		result->collisions += values[i] == values[i - 1];
+	}
+	result->expected_collisions = (double)count * (count - 1) / 2 / 4294967296.0;
+
+	free(values);
+}
+
+static void measure_avalanche(Hashmap_hash hash, DArray *keys, QualityResult *result)
+{
+	static int flips[AVALANCHE_BITS][32];
+	int trials[AVALANCHE_BITS] = {0};
+	double bias = 0;
+	int bits = 0;
+	int pairs = 0;
+	int i = 0;
+	int j = 0;
+	int k = 0;
+
+	memset(flips, 0, sizeof(flips));
+
+	// keys from the whole corpus, the first ones may all be short
+	for(k = 0; k < AVALANCHE_KEYS; k++) {
+		bstring key = bstrcpy(DArray_get(keys, (long)k * DArray_count(keys) / AVALANCHE_KEYS));
+		uint32_t original = hash(key);
+
+		bits = blength(key) * 8 < AVALANCHE_BITS ? blength(key) * 8 : AVALANCHE_BITS;
+
+		for(i = 0; i < bits; i++) {
+			key->data[i / 8] ^= 1 << (i % 8);
+			uint32_t changed = original ^ hash(key);
+			key->data[i / 8] ^= 1 << (i % 8);
+
+			trials[i]++;
+			for(j = 0; j < 32; j++) {
+				flips[i][j] += (changed >> j) & 1;
+			}
+		}
+
+		bdestroy(key);
+	}
+
+	result->avalanche_mean = 0;
+	result->avalanche_worst = 0;
+
+	for(i = 0; i < AVALANCHE_BITS; i++) {
+		// too few keys this long to tell bias from noise
+		if(trials[i] < AVALANCHE_KEYS / 2) continue;
+
+		for(j = 0; j < 32; j++) {
+			bias = 2.0 * flips[i][j] / trials[i] - 1;
+			bias = bias < 0 ? -bias : bias;
+			result->avalanche_mean += bias;
+			pairs++;
+
+			if(bias > result->avalanche_worst) {
+				result->avalanche_worst = bias;
+			}
+		}
+	}
+
+	result->avalanche_mean /= pairs > 0 ? pairs : 1;
+}
+
+static void measure_speed(Hashmap_hash hash, DArray *keys, QualityResult *result)
+{
+	struct timespec start, end;
+	uint32_t sink = 0;
+	int round = 0;
+	int i = 0;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(round = 0; round < TIMING_ROUNDS; round++) {
+		for(i = 0; i < DArray_count(keys); i++) {
+			sink += hash(keys->contents[i]);
+		}
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+	result->ns_per_key = (double)get_diff(start, end) / TIMING_ROUNDS / DArray_count(keys);
+
+	debug("Sink: %u", sink);
+}
+
+char *test_quality()
+{
+	struct {
+		const char *name;
+		DArray *(*create)();
+	} corpora[] = {
+		{"integers", integer_keys},
+		{"words", word_keys},
+		{"urls", url_keys},
+		{"random", random_keys}
+	};
+	int corpora_number = sizeof(corpora) / sizeof(corpora[0]);
+	QualityResult results[4][HASHES_NUMBER];
+	int passed[HASHES_NUMBER] = {0};
+	QualityResult *result = NULL;
+	int best = 0;
+	int c = 0;
+	int h = 0;
+
+	FILE *csv = fopen(QUALITY_CSV, "w");
+	mu_assert(csv != NULL, "Failed to open " QUALITY_CSV);
+
+	fprintf(csv, "hash,corpus,keys,chi2_per_bucket,avalanche_mean,avalanche_worst,"
+			"collisions,expected_collisions,ns_per_key,passed\n");
+
+	srand(1);
+
+	for(c = 0; c < corpora_number; c++) {
+		DArray *keys = corpora[c].create();
+		mu_assert(DArray_count(keys) == QUALITY_KEYS, "Failed to create corpus.");
+
+		for(h = 0; h < HASHES_NUMBER; h++) {
+			result = &results[c][h];
+
+			measure_distribution(hashes[h].hash, keys, result);
+			measure_avalanche(hashes[h].hash, keys, result);
+			measure_speed(hashes[h].hash, keys, result);
+
+			int pass = result->chi2_per_bucket < MAX_CHI2_PER_BUCKET &&
+				result->avalanche_worst < MAX_AVALANCHE_WORST &&
+				result->collisions < MAX_COLLISIONS(result->expected_collisions);
+			passed[h] += pass;
+
+			fprintf(csv, "%s,%s,%d,%.4lf,%.4lf,%.4lf,%d,%.2lf,%.2lf,%d\n",
+					hashes[h].name, corpora[c].name, QUALITY_KEYS,
+					result->chi2_per_bucket, result->avalanche_mean, result->avalanche_worst,
+					result->collisions, result->expected_collisions, result->ns_per_key, pass);
+		}
+
+		destroy_corpus(keys);
+	}
+
+	fclose(csv);
+
+	// the fastest of the hashes good on every corpus, for every corpus
+	printf("\nCorpus\t\tFastest good hash\tns/key\n");
+	for(c = 0; c < corpora_number; c++) {
+		best = -1;
+
+		for(h = 0; h < HASHES_NUMBER; h++) {
+			if(passed[h] == corpora_number &&
+					(best < 0 || results[c][h].ns_per_key < results[c][best].ns_per_key)) {
+				best = h;
+			}
+		}
+
+		mu_assert(best >= 0, "No hash passed the quality thresholds.");
+		printf("%s\t%s\t\t%.2lf\n", corpora[c].name, hashes[best].name, results[c][best].ns_per_key);
+	}
+	printf("Full results are in " QUALITY_CSV "\n");
+
+	// the keyed defaults must pass, loselose is the known bad one
+	mu_assert(passed[hash_index("siphash")] == corpora_number, "siphash should pass every corpus.");
+	mu_assert(passed[hash_index("wy")] == corpora_number, "wy should pass every corpus.");
+	mu_assert(passed[hash_index("loselose")] == 0, "loselose shouldn't pass any corpus.");
+
+	return NULL;
+}
+
+char *all_tests()
+{
+	mu_suite_start();
+
+	mu_run_test(test_quality);
+
+	return NULL;
+}
+
+RUN_TESTS(all_tests);
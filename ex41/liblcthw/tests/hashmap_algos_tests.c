@@ -1,7 +1,7 @@
 #include <lcthw/bstrlib.h>
 #include <lcthw/hashmap.h>
 #include <lcthw/hashmap_algos.h>
-#include <lcthw/darray.h>
+#include <lcthw/tests_routines.h>
 #include "minunit.h"
 
 struct tagbstring test1 = bsStatic("test data 1");
@@ -78,90 +78,150 @@ char *test_sdbm()
 	return NULL;
 }
 
-#define BUCKETS 100
-#define BUFFER_LEN 20
-#define NUM_KEYS BUCKETS * 1000
-enum {ALGO_FNV1A, ALGO_ADLER32, ALGO_DJB, ALGO_DEFAULT, ALGO_LOSE, ALGO_SDBM};
-
-int gen_keys(DArray *keys, int num_keys)
+char *test_wy()
 {
-	int i = 0;
-	FILE *urand = fopen("/dev/urandom", "r");
-	check(urand != NULL, "Failed to open /dev/urandom");
-
-	struct bStream *stream = bsopen((bNread)fread, urand);
-	check(stream != NULL, "Failed to open /dev/urandom");
+	uint32_t hash = Hashmap_wy_hash(&test1);
+	mu_assert(hash != 0, "Bad hash.");
+	mu_assert(hash != Hashmap_wy_hash(&test2), "Keys with one different byte collide.");
+	mu_assert(hash == Hashmap_wy_hash(&test1), "Hash should be the same every time.");
 
-	bstring key = bfromcstr("");
-	int rc = 0;
+	return NULL;
+}
 
-	// FNV1a histogram
-	for(i = 0; i < num_keys; i++) {
-		rc = bsread(key, stream, BUFFER_LEN);
-		check(rc >= 0, "Failed to read from /dev/urandom.");
+char *test_siphash()
+{
+	uint64_t zero_seed[2] = {0, 0};
+	uint64_t seed[2] = {1, 2};
+	struct tagbstring short_key = bsStatic("abc");
+	struct tagbstring long_key = bsStatic("0123456789abcdef-long key");
 
-		DArray_push(keys, bstrcpy(key));
-	}
+	// SipHash-1-3 with a zero key, folded to 32 bits (Python hash(b'abc') with PYTHONHASHSEED=0)
+	mu_assert(Hashmap_siphash(&short_key, zero_seed) == 3290297170U, "Wrong SipHash-1-3 of a short key.");
+	mu_assert(Hashmap_siphash(&long_key, zero_seed) == 1116811958U, "Wrong SipHash-1-3 of a long key.");
 
-	bsclose(stream);
-	fclose(urand);
-	return 0;
+	mu_assert(Hashmap_siphash(&test1, seed) != Hashmap_siphash(&test1, zero_seed), "Seed should change the hash.");
+	mu_assert(Hashmap_siphash(&test1, seed) != Hashmap_siphash(&test2, seed), "Keys with one different byte collide.");
 
-error:
-	return -1;
+	return NULL;
 }
 
-void destroy_keys(DArray *keys)
+#define LONG_KEY_LEN 20000
+
+char *test_long_keys()
 {
+	unsigned char buffer[LONG_KEY_LEN + 16];
+	struct tagbstring key = {0};
+	uint32_t wy = 0;
+	int len = 0;
 	int i = 0;
-	for(i = 0; i < NUM_KEYS; i++) {
-		bdestroy(DArray_get(keys, i));
+
+	for(i = 0; i < LONG_KEY_LEN; i++) {
+		buffer[i] = rand();
 	}
 
-	DArray_destroy(keys);
+	// every length around the step sizes and past the Adler block of 5552 bytes
+	for(len = 0; len <= LONG_KEY_LEN; len += len < 300 ? 1 : 997) {
+		key.data = buffer;
+		key.slen = len;
+		key.mlen = -1;
+
+		mu_assert(Hashmap_adler32_simd_hash(&key) == Hashmap_adler32_hash(&key),
+				"SIMD Adler-32 differs from Adler-32.");
+
+		// bytes after the key must not change the hash
+		wy = Hashmap_wy_hash(&key);
+		buffer[len] ^= 0xff;
+		mu_assert(wy == Hashmap_wy_hash(&key), "Hash reads past the key.");
+		buffer[len] ^= 0xff;
+
+		// but the first and the last byte of the key do
+		if(len > 0) {
+			buffer[len - 1] ^= 0x01;
+			mu_assert(wy != Hashmap_wy_hash(&key), "Last byte doesn't change the hash.");
+			buffer[len - 1] ^= 0x01;
+			buffer[0] ^= 0x01;
+			mu_assert(len == 1 || wy != Hashmap_wy_hash(&key), "First byte doesn't change the hash.");
+			buffer[0] ^= 0x01;
+		}
+	}
+
+	return NULL;
 }
 
-void fill_distribution(int *stats, DArray *keys, Hashmap_hash hash_func)
+// build with OPTFLAGS=-DHASH_BENCH_BYTES=... for longer runs
+#ifndef HASH_BENCH_BYTES
+#define HASH_BENCH_BYTES (16 * 1024 * 1024)
+#endif
+
+#define HASH_BENCH_KEYS 256
+
+char *test_throughput_perfomance()
 {
+	struct {
+		const char *name;
+		Hashmap_hash hash;
+	} algos[] = {
+		{"FNV1A", Hashmap_fnv1a_hash},
+		{"A32", Hashmap_adler32_hash},
+		{"DJB", Hashmap_djb_hash},
+		{"DEFAULT", default_hash},
+		{"SDBM", Hashmap_sdbm_hash},
+		{"WY", Hashmap_wy_hash},
+		{"A32SIMD", Hashmap_adler32_simd_hash}
+	};
+	int algos_number = sizeof(algos) / sizeof(algos[0]);
+	struct tagbstring keys[HASH_BENCH_KEYS];
+	struct timespec start, end;
+	uint32_t sink = 0;
+	int len = 0;
+	int a = 0;
 	int i = 0;
-	uint32_t hash = 0;
+	int round = 0;
+	int rounds = 0;
+
+	// sliding windows over one random buffer, 256 keys of every length
+	unsigned char *buffer = malloc(4096 + HASH_BENCH_KEYS);
+	mu_assert(buffer != NULL, "Failed to allocate keys.");
 
-	for(i = 0; i < DArray_count(keys); i++) {
-		hash = hash_func(DArray_get(keys, i));
-		stats[hash % BUCKETS] += 1;
+	for(i = 0; i < 4096 + HASH_BENCH_KEYS; i++) {
+		buffer[i] = rand();
 	}
-}
 
-char *test_distribution()
-{
-	int i = 0;
-	int stats[6][BUCKETS] = {{0}};
+	printf("\nHash\tGB/s for key lengths of");
+	for(len = 4; len <= 4096; len *= 4) {
+		printf("\t%d", len);
+	}
+	printf("\n");
 
-	DArray *keys = DArray_create(sizeof(100), NUM_KEYS);
+	for(a = 0; a < algos_number; a++) {
+		printf("%s", algos[a].name);
 
-	mu_assert(gen_keys(keys, NUM_KEYS) == 0, "Failed to generate random keys.");
+		for(len = 4; len <= 4096; len *= 4) {
+			for(i = 0; i < HASH_BENCH_KEYS; i++) {
+				keys[i].data = buffer + i;
+				keys[i].slen = len;
+				keys[i].mlen = -1;
+			}
 
-	fill_distribution(stats[ALGO_FNV1A], keys, Hashmap_fnv1a_hash);
-	fill_distribution(stats[ALGO_ADLER32], keys, Hashmap_adler32_hash);
-	fill_distribution(stats[ALGO_DJB], keys, Hashmap_djb_hash);
-	fill_distribution(stats[ALGO_DEFAULT], keys, default_hash);
-	fill_distribution(stats[ALGO_LOSE], keys, Hashmap_loselose_hash);
-	fill_distribution(stats[ALGO_SDBM], keys, Hashmap_sdbm_hash);
+			rounds = HASH_BENCH_BYTES / (len * HASH_BENCH_KEYS) + 1;
 
-	fprintf(stderr, "FNV\tA32\tDJB\tDEFAULT\tLOSE\tSDBM\n");
+			clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+			for(round = 0; round < rounds; round++) {
+				for(i = 0; i < HASH_BENCH_KEYS; i++) {
+					sink += algos[a].hash(&keys[i]);
+				}
+			}
+			clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
 
-	for(i = 0; i < BUCKETS; i++) {
-		fprintf(stderr, "%d\t%d\t%d\t%d\t%d\t%d\n",
-				stats[ALGO_FNV1A][i],
-				stats[ALGO_ADLER32][i],
-				stats[ALGO_DJB][i],
-				stats[ALGO_DEFAULT][i],
-				stats[ALGO_LOSE][i],
-				stats[ALGO_SDBM][i]);
+			printf("\t%.2lf", (double)rounds * HASH_BENCH_KEYS * len / get_diff(start, end));
+		}
+
+		printf("\n");
 	}
 
-	destroy_keys(keys);
-	
+	debug("Sink: %u", sink);
+	free(buffer);
+
 	return NULL;
 }
 
@@ -174,8 +234,11 @@ char *all_tests()
 	mu_run_test(test_djb);
 	mu_run_test(test_loselose);
 	mu_run_test(test_sdbm);
+	mu_run_test(test_wy);
+	mu_run_test(test_siphash);
+	mu_run_test(test_long_keys);
 
-	mu_run_test(test_distribution);
+	mu_run_test(test_throughput_perfomance);
 
 	return NULL;
 }
@@ -1,7 +1,39 @@
 #include "minunit.h"
 #include <lcthw/hashmap.h>
+#include <lcthw/hashmap_algos.h>
 #include <assert.h>
 #include <lcthw/bstrlib.h>
+#include <lcthw/tests_routines.h>
+
+/*
+ * Allocation counting hook: while 'count_allocations' is set every
+ * malloc, calloc and realloc made by the test and by liblcthw is
+ * counted in 'allocations'. Works with glibc only.
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static int count_allocations = 0;
+static unsigned long allocations = 0;
+
+void *malloc(size_t size)
+{
+	if(count_allocations) allocations++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	if(count_allocations) allocations++;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	if(count_allocations) allocations++;
+	return __libc_realloc(ptr, size);
+}
 
 Hashmap *map = NULL;
 static int traverse_called = 0;
@@ -30,6 +62,8 @@ static int nodes_distribution(Hashmap *map)
 {
 	int i = 0;
 
+	if(map->engine != HASHMAP_CHAINED) return 0;
+
 	debug("NODES DISTRIBUTION:");
 	for(i = 0; i < DArray_count(map->buckets); i++) {
 		DArray *bucket = DArray_get(map->buckets, i);
@@ -68,6 +102,17 @@ char *test_create()
 	return NULL;
 }
 
+char *test_create_flat()
+{
+	map = Hashmap_create_flat(NULL, NULL, 0);
+	mu_assert(map != NULL, "Failed to create flat map.");
+	mu_assert(map->buckets_number == DEFAULT_NUMBER_OF_SLOTS, "Wrong slots number.");
+
+	traverse_called = 0;
+
+	return NULL;
+}
+
 char *test_destroy()
 {
 	Hashmap_destroy(map);
@@ -136,7 +181,7 @@ char *test_delete()
 
 char *test_rehash()
 {
-	Hashmap *map1 = Hashmap_create_advanced(NULL, djb2_hash, 1, 1);
+	Hashmap *map1 = Hashmap_create_advanced(NULL, djb2_hash, 1, 1, 0);
 
 	mu_assert(map1->buckets_number == 1, "Wrong buckets number.");
 	
@@ -241,7 +286,7 @@ char *filling_defect()
 		values[i] = generate_string();
 	}
 	
-	Hashmap *map1 = Hashmap_create_advanced(NULL, djb2_hash, 1, 1);	
+	Hashmap *map1 = Hashmap_create_advanced(NULL, djb2_hash, 1, 1, 0);	
 
 	// part 1
 	debug("PART 1");
@@ -284,6 +329,1080 @@ char *filling_defect()
 	return NULL;
 }
 
+char *test_incremental_rehash()
+{
+	bstring keys[STRINGS_NUMBER] = {NULL};
+	int i = 0;
+
+	for(i = 0; i < STRINGS_NUMBER; i++) {
+		keys[i] = generate_string();
+	}
+
+	Hashmap *map1 = Hashmap_create_advanced(NULL, djb2_hash, 1, 1, 0);
+	mu_assert(Hashmap_set_rehash_step(map1, 1) == 0, "Failed to set rehash step.");
+
+	for(i = 0; i < STRINGS_NUMBER; i++) {
+		Hashmap_set(map1, keys[i], keys[i]);
+		mu_assert(map1->buckets_number == (uint32_t)i + 1, "Wrong buckets number.");
+		mu_assert(Hashmap_get(map1, keys[i]) == keys[i], "Wrong value.");
+	}
+
+	traverse_called = 0;
+	Hashmap_traverse(map1, traverse_good_cb);
+	mu_assert(traverse_called == STRINGS_NUMBER, "Wrong count traverse.");
+
+	for(i = 0; i < STRINGS_NUMBER; i++) {
+		mu_assert(Hashmap_get(map1, keys[i]) == keys[i], "Wrong value.");
+	}
+
+	for(i = 0; i < STRINGS_NUMBER / 2; i++) {
+		mu_assert(Hashmap_delete(map1, keys[i]) == keys[i], "Wrong deleted value.");
+		mu_assert(map1->buckets_number == STRINGS_NUMBER - (uint32_t)i - 1, "Wrong buckets number.");
+	}
+
+	for(i = 0; i < STRINGS_NUMBER; i++) {
+		bstring result = Hashmap_get(map1, keys[i]);
+		mu_assert(result == (i < STRINGS_NUMBER / 2 ? NULL : keys[i]), "Wrong value.");
+	}
+
+	// turning it off finishes the rehash in progress
+	mu_assert(Hashmap_set_rehash_step(map1, 0) == 0, "Failed to set rehash step.");
+	mu_assert(map1->old_buckets == NULL, "Rehash should be finished.");
+	mu_assert(map1->counter == STRINGS_NUMBER / 2, "Wrong number of nodes.");
+
+	Hashmap_destroy(map1);
+
+	for(i = 0; i < STRINGS_NUMBER; i++) {
+		bdestroy(keys[i]);
+	}
+
+	return NULL;
+}
+
+char *test_geometric_growth()
+{
+	bstring keys[1000] = {NULL};
+	int i = 0;
+	uint32_t step = 0;
+
+	for(i = 0; i < 1000; i++) {
+		keys[i] = bformat("%d", i);
+	}
+
+	// the same sequence for full and incremental rehash
+	for(step = 0; step <= 1; step++) {
+		Hashmap *map1 = Hashmap_create_advanced(NULL, NULL, 100, 0, 2.0);
+		mu_assert(map1->buckets_number == 128, "Buckets number should be rounded up to a power of two.");
+		mu_assert(Hashmap_set_rehash_step(map1, step) == 0, "Failed to set rehash step.");
+
+		for(i = 0; i < 1000; i++) {
+			Hashmap_set(map1, keys[i], keys[i]);
+			mu_assert(map1->counter <= map1->buckets_number * 2, "Too many nodes per bucket.");
+			mu_assert((map1->buckets_number & (map1->buckets_number - 1)) == 0, "Buckets number isn't a power of two.");
+		}
+
+		mu_assert(map1->buckets_number == 512, "Wrong buckets number.");
+		mu_assert(map1->rehash_count == 2, "Wrong rehash count.");
+
+		for(i = 0; i < 1000; i++) {
+			mu_assert(Hashmap_get(map1, keys[i]) == keys[i], "Wrong value.");
+		}
+
+		for(i = 0; i < 1000; i++) {
+			mu_assert(Hashmap_delete(map1, keys[i]) == keys[i], "Wrong deleted value.");
+		}
+
+		mu_assert(map1->buckets_number == 128, "Buckets should shrink back.");
+		mu_assert(map1->rehash_count == 4, "Wrong rehash count.");
+
+		Hashmap_destroy(map1);
+	}
+
+	for(i = 0; i < 1000; i++) {
+		bdestroy(keys[i]);
+	}
+
+	return NULL;
+}
+
+static char *run_get_allocations(Hashmap *map1, const char *name)
+{
+	bstring keys[1000] = {NULL};
+	struct tagbstring missing = bsStatic("missing key");
+	int i = 0;
+
+	for(i = 0; i < 1000; i++) {
+		keys[i] = bformat("%d", i);
+		Hashmap_set(map1, keys[i], keys[i]);
+	}
+
+	// make sure the hook sees allocations at all
+	allocations = 0;
+	count_allocations = 1;
+	bstring probe = bfromcstr("probe");
+	count_allocations = 0;
+	bdestroy(probe);
+	mu_assert(allocations > 0, "Allocation hook doesn't count.");
+
+	allocations = 0;
+	count_allocations = 1;
+
+	for(i = 0; i < 1000; i++) {
+		if(Hashmap_get(map1, keys[i]) != keys[i]) break;
+		if(Hashmap_get(map1, &missing) != NULL) break;
+	}
+
+	count_allocations = 0;
+
+	debug("Hashmap_get %s made %lu allocations.", name, allocations);
+	mu_assert(i == 1000, "Wrong value.");
+	mu_assert(allocations == 0, "Hashmap_get shouldn't allocate memory.");
+
+	Hashmap_destroy(map1);
+
+	for(i = 0; i < 1000; i++) {
+		bdestroy(keys[i]);
+	}
+
+	return NULL;
+}
+
+char *test_get_allocations()
+{
+	char *message = run_get_allocations(Hashmap_create(NULL, NULL), "(chained)");
+	if(message) return message;
+
+	return run_get_allocations(Hashmap_create_flat(NULL, NULL, 0), "(flat)");
+}
+
+#define MANY_KEYS_NUMBER 1000
+
+static char *run_get_set_many(Hashmap *map1, const char *name)
+{
+	bstring keys[MANY_KEYS_NUMBER + 1] = {NULL};
+	void *out[MANY_KEYS_NUMBER + 1] = {NULL};
+	struct tagbstring missing = bsStatic("missing key");
+	int i = 0;
+
+	debug("Batch get and set %s.", name);
+
+	for(i = 0; i < MANY_KEYS_NUMBER; i++) {
+		keys[i] = bformat("%d", i);
+	}
+
+	int rc = Hashmap_set_many(map1, (void **)keys, (void **)keys, MANY_KEYS_NUMBER);
+	mu_assert(rc == 0, "Failed to set many.");
+	mu_assert(map1->counter == MANY_KEYS_NUMBER, "Wrong number of nodes.");
+
+	keys[MANY_KEYS_NUMBER] = &missing;
+	rc = Hashmap_get_many(map1, (void **)keys, MANY_KEYS_NUMBER + 1, out);
+	mu_assert(rc == MANY_KEYS_NUMBER, "Wrong number of found keys.");
+
+	for(i = 0; i < MANY_KEYS_NUMBER; i++) {
+		mu_assert(out[i] == keys[i], "Wrong value.");
+	}
+	mu_assert(out[MANY_KEYS_NUMBER] == NULL, "Missing key should give NULL.");
+
+	// a batch smaller than HASHMAP_PREFETCH_BATCH and an empty one
+	rc = Hashmap_get_many(map1, (void **)keys + 10, 3, out);
+	mu_assert(rc == 3 && out[0] == keys[10] && out[2] == keys[12], "Wrong small batch.");
+	mu_assert(Hashmap_get_many(map1, (void **)keys, 0, out) == 0, "Wrong empty batch.");
+
+	// a NULL key in the middle of a batch fails it before anything is hashed
+	void *bad[5] = {&missing, keys[1], NULL, keys[3], keys[4]};
+	mu_assert(Hashmap_set_many(map1, bad, bad, 5) == -1, "Should fail on a NULL key.");
+	mu_assert(Hashmap_get_many(map1, bad, 5, out) == -1, "Should fail on a NULL key.");
+	bad[2] = keys[2];
+	void *bad_data[5] = {&missing, keys[1], keys[2], NULL, keys[4]};
+	mu_assert(Hashmap_set_many(map1, bad, bad_data, 5) == -1, "Should fail on NULL data.");
+	mu_assert(map1->counter == MANY_KEYS_NUMBER, "Failed batch shouldn't set anything.");
+
+	Hashmap_destroy(map1);
+
+	for(i = 0; i < MANY_KEYS_NUMBER; i++) {
+		bdestroy(keys[i]);
+	}
+
+	return NULL;
+}
+
+char *test_get_set_many()
+{
+	char *message = run_get_set_many(Hashmap_create(NULL, NULL), "(chained)");
+	if(message) return message;
+
+	// a rehash runs in the middle of the batches
+	Hashmap *incremental = Hashmap_create(NULL, NULL);
+	Hashmap_set_rehash_step(incremental, 1);
+	message = run_get_set_many(incremental, "(incremental rehash)");
+	if(message) return message;
+
+	return run_get_set_many(Hashmap_create_flat(NULL, NULL, 0), "(flat)");
+}
+
+#define ITER_KEYS_NUMBER 1000
+
+static int traverse_ctx_cb(HashmapNode *node, void *ctx)
+{
+	*(int *)ctx += node->data != NULL;
+
+	return 0;
+}
+
+static int traverse_ctx_stop_cb(HashmapNode *node, void *ctx)
+{
+	(void)node;
+
+	return --*(int *)ctx == 0 ? 7 : 0;
+}
+
+static char *run_iterator(Hashmap *map1, const char *name)
+{
+	bstring keys[ITER_KEYS_NUMBER] = {NULL};
+	int seen[ITER_KEYS_NUMBER] = {0};
+	HashmapIter iter;
+	HashmapNode *node = NULL;
+	int visited = 0;
+	int i = 0;
+
+	debug("Iterator %s.", name);
+
+	for(i = 0; i < ITER_KEYS_NUMBER; i++) {
+		keys[i] = bformat("%d", i);
+		Hashmap_set(map1, keys[i], keys[i]);
+	}
+
+	if(map1->rehash_step > 0) {
+		mu_assert(map1->old_buckets != NULL, "Rehash should be in progress.");
+	}
+
+	// delete the odd keys while walking, every node is still seen once
+	Hashmap_iter_init(map1, &iter);
+	while((node = Hashmap_iter_next(&iter)) != NULL) {
+		i = atoi((char *)((bstring)node->key)->data);
+		mu_assert(seen[i] == 0, "Node visited twice.");
+		seen[i] = 1;
+		visited++;
+
+		if(i % 2 == 1) {
+			mu_assert(Hashmap_iter_remove_current(&iter) == keys[i], "Wrong removed value.");
+		}
+	}
+
+	mu_assert(visited == ITER_KEYS_NUMBER, "Wrong number of visited nodes.");
+	mu_assert(Hashmap_iter_remove_current(&iter) == NULL, "Nothing to remove after the end.");
+	mu_assert(map1->counter == ITER_KEYS_NUMBER / 2, "Wrong number of nodes.");
+
+	for(i = 0; i < ITER_KEYS_NUMBER; i++) {
+		mu_assert(Hashmap_get(map1, keys[i]) == (i % 2 ? NULL : keys[i]), "Wrong value after removing.");
+	}
+
+	visited = 0;
+	mu_assert(Hashmap_traverse_ctx(map1, traverse_ctx_cb, &visited) == 0, "Failed to traverse.");
+	mu_assert(visited == ITER_KEYS_NUMBER / 2, "Wrong count traverse with context.");
+
+	visited = 10;
+	mu_assert(Hashmap_traverse_ctx(map1, traverse_ctx_stop_cb, &visited) == 7, "Traverse should stop.");
+	mu_assert(visited == 0, "Wrong count traverse for stop.");
+
+	// remove everything in one pass
+	Hashmap_iter_init(map1, &iter);
+	while(Hashmap_iter_next(&iter) != NULL) {
+		Hashmap_iter_remove_current(&iter);
+	}
+	mu_assert(map1->counter == 0, "Map should be empty.");
+
+	Hashmap_iter_init(map1, &iter);
+	mu_assert(Hashmap_iter_next(&iter) == NULL, "Empty map has no nodes.");
+
+	Hashmap_destroy(map1);
+
+	for(i = 0; i < ITER_KEYS_NUMBER; i++) {
+		bdestroy(keys[i]);
+	}
+
+	return NULL;
+}
+
+char *test_iterator()
+{
+	char *message = run_iterator(Hashmap_create(NULL, NULL), "(chained)");
+	if(message) return message;
+
+	message = run_iterator(Hashmap_create_advanced(NULL, NULL, 10, 10, 0), "(linear growth)");
+	if(message) return message;
+
+	// the 1000th key starts a rehash, so the walk sees both tables
+	Hashmap *incremental = Hashmap_create_advanced(NULL, NULL, 512, 0, 999.0f / 512);
+	Hashmap_set_rehash_step(incremental, 1);
+	message = run_iterator(incremental, "(incremental rehash)");
+	if(message) return message;
+
+	return run_iterator(Hashmap_create_flat(NULL, NULL, 0), "(flat)");
+}
+
+#define PREHASHED_KEYS_NUMBER 1000
+
+static int hash_calls = 0;
+
+static uint32_t counting_hash(void *key)
+{
+	hash_calls++;
+	return djb2_hash(key);
+}
+
+static char *run_prehashed(Hashmap *map1, const char *name)
+{
+	bstring keys[PREHASHED_KEYS_NUMBER];
+	uint32_t hashes[PREHASHED_KEYS_NUMBER];
+	int i = 0;
+
+	debug("Prehashed %s", name);
+
+	for(i = 0; i < PREHASHED_KEYS_NUMBER; i++) {
+		keys[i] = bformat("prehashed key %d", i);
+	}
+
+	hash_calls = 0;
+	for(i = 0; i < PREHASHED_KEYS_NUMBER; i++) {
+		hashes[i] = Hashmap_key_hash(map1, keys[i]);
+		mu_assert(hashes[i] == djb2_hash(keys[i]), "Wrong key hash.");
+		mu_assert(Hashmap_set_prehashed(map1, keys[i], hashes[i], keys[i]) == 0, "Failed to set.");
+	}
+
+	// growing moved every node, but hashed no key again
+	mu_assert(hash_calls == PREHASHED_KEYS_NUMBER, "Resize shouldn't hash keys.");
+
+	for(i = 0; i < PREHASHED_KEYS_NUMBER; i++) {
+		mu_assert(Hashmap_get_prehashed(map1, keys[i], hashes[i]) == keys[i], "Wrong prehashed value.");
+		mu_assert(Hashmap_get(map1, keys[i]) == keys[i], "Wrong value.");
+	}
+	mu_assert(hash_calls == 2 * PREHASHED_KEYS_NUMBER, "Prehashed get shouldn't hash keys.");
+
+	for(i = 0; i < PREHASHED_KEYS_NUMBER; i++) {
+		mu_assert(Hashmap_delete_prehashed(map1, keys[i], hashes[i]) == keys[i], "Failed to delete.");
+		mu_assert(Hashmap_get_prehashed(map1, keys[i], hashes[i]) == NULL, "Should delete.");
+	}
+	mu_assert(hash_calls == 2 * PREHASHED_KEYS_NUMBER, "Shrinking shouldn't hash keys.");
+
+	for(i = 0; i < PREHASHED_KEYS_NUMBER; i++) {
+		bdestroy(keys[i]);
+	}
+
+	return NULL;
+}
+
+char *test_prehashed()
+{
+	char *message = NULL;
+	Hashmap *seeded = Hashmap_create(NULL, NULL);
+	struct tagbstring key = bsStatic("seeded key");
+
+	mu_assert(Hashmap_key_hash(seeded, &key) == Hashmap_siphash(&key, seeded->seed), "Key hash should be seeded.");
+	Hashmap_destroy(seeded);
+
+	Hashmap *chained = Hashmap_create(NULL, counting_hash);
+	message = run_prehashed(chained, "chained");
+	Hashmap_destroy(chained);
+	if(message) return message;
+
+	Hashmap *incremental = Hashmap_create(NULL, counting_hash);
+	Hashmap_set_rehash_step(incremental, 1);
+	message = run_prehashed(incremental, "incremental");
+	Hashmap_destroy(incremental);
+	if(message) return message;
+
+	Hashmap *flat = Hashmap_create_flat(NULL, counting_hash, 0);
+	message = run_prehashed(flat, "flat");
+	Hashmap_destroy(flat);
+
+	return message;
+}
+
+#define STATS_KEYS_NUMBER 1000
+
+static uint32_t constant_hash(void *key)
+{
+	(void)key;
+
+	return 42;
+}
+
+static char *run_stats(Hashmap *map1, const char *name)
+{
+	bstring keys[STATS_KEYS_NUMBER] = {NULL};
+	HashmapStats stats;
+	uint32_t histogram_sum = 0;
+	int i = 0;
+
+	for(i = 0; i < STATS_KEYS_NUMBER; i++) {
+		keys[i] = bformat("%d", i);
+		Hashmap_set(map1, keys[i], keys[i]);
+	}
+
+	for(i = 0; i < STATS_KEYS_NUMBER; i++) {
+		Hashmap_get(map1, keys[i]);
+	}
+
+	mu_assert(Hashmap_stats(map1, &stats) == 0, "Failed to get stats.");
+
+	printf("\nHashmap_stats %s: %u nodes, %u/%u buckets used, longest %u, %lf probes per get, "
+			"%zu table, %zu bucket, %zu node bytes, %u rehashes, %lu lookups, %lu compares.\n",
+			name, stats.nodes, stats.used_buckets, stats.buckets, stats.longest, stats.average_probes,
+			stats.table_bytes, stats.bucket_bytes, stats.node_bytes, stats.rehash_count,
+			(unsigned long)stats.lookups, (unsigned long)stats.compares);
+
+	for(i = 0; i < HASHMAP_STATS_HISTOGRAM; i++) {
+		histogram_sum += stats.histogram[i];
+	}
+
+	mu_assert(stats.nodes == STATS_KEYS_NUMBER, "Wrong number of nodes.");
+	mu_assert(stats.rehash_count == map1->rehash_count, "Wrong rehash count.");
+	mu_assert(stats.average_probes >= 1, "A get looks at one node at least.");
+	mu_assert(stats.table_bytes > 0, "Table takes memory.");
+
+	if(map1->engine == HASHMAP_FLAT) {
+		mu_assert(histogram_sum == stats.nodes, "Flat histogram counts nodes.");
+		mu_assert(stats.used_buckets == stats.nodes, "Every node has a slot.");
+		mu_assert(stats.longest < stats.buckets, "Probe can't be longer than the table.");
+	} else {
+		mu_assert(histogram_sum == stats.buckets, "Chained histogram counts buckets.");
+		mu_assert(stats.used_buckets == stats.buckets - stats.histogram[0], "Wrong number of used buckets.");
+		mu_assert(stats.node_bytes == STATS_KEYS_NUMBER * sizeof(HashmapNode), "Wrong node bytes.");
+		mu_assert(stats.bucket_bytes > 0, "Buckets take memory.");
+	}
+
+#ifdef HASHMAP_COUNT_COMPARES
+	mu_assert(stats.lookups == 2 * STATS_KEYS_NUMBER, "Every set and get is a lookup.");
+	mu_assert(stats.compares >= STATS_KEYS_NUMBER, "Every get compares keys.");
+#else
+	mu_assert(stats.lookups == 0 && stats.compares == 0, "Counters are off.");
+#endif
+
+	Hashmap_destroy(map1);
+
+	for(i = 0; i < STATS_KEYS_NUMBER; i++) {
+		bdestroy(keys[i]);
+	}
+
+	return NULL;
+}
+
+char *test_stats()
+{
+	HashmapStats stats;
+
+	char *message = run_stats(Hashmap_create(NULL, NULL), "(chained)");
+	if(message) return message;
+
+	message = run_stats(Hashmap_create_flat(NULL, NULL, 0), "(flat)");
+	if(message) return message;
+
+	Hashmap *collisions = Hashmap_create(NULL, constant_hash);
+	Hashmap_set(collisions, &test1, &expect1);
+	Hashmap_set(collisions, &test2, &expect2);
+	Hashmap_set(collisions, &test3, &expect3);
+
+	mu_assert(Hashmap_stats(collisions, &stats) == 0, "Failed to get stats.");
+	mu_assert(stats.used_buckets == 1, "All nodes should be in one bucket.");
+	mu_assert(stats.longest == 3, "Wrong longest bucket.");
+	mu_assert(stats.histogram[3] == 1, "Wrong histogram.");
+	// 2 steps of binary search, then 1, 2 and 3 nodes with the same hash
+	mu_assert(stats.average_probes == 4, "Wrong probes per get.");
+
+	Hashmap_destroy(collisions);
+
+	return message;
+}
+
+#define FLAT_KEYS_NUMBER 10000
+
+char *test_flat_fuzzing()
+{
+	bstring keys[FLAT_KEYS_NUMBER] = {NULL};
+	bstring result = NULL;
+	int i = 0;
+
+	// small start so the slots grow and shrink many times
+	Hashmap *map1 = Hashmap_create_flat(NULL, NULL, 1);
+	mu_assert(map1 != NULL, "Failed to create flat map.");
+
+	for(i = 0; i < FLAT_KEYS_NUMBER; i++) {
+		keys[i] = bformat("%d", rand());
+		Hashmap_set(map1, keys[i], keys[i]);
+	}
+
+	for(i = 0; i < FLAT_KEYS_NUMBER; i++) {
+		result = Hashmap_get(map1, keys[i]);
+		mu_assert(result != NULL && biseq(result, keys[i]), "Wrong value.");
+	}
+
+	traverse_called = 0;
+	Hashmap_traverse(map1, traverse_good_cb);
+	mu_assert(traverse_called == (int)map1->counter, "Wrong count traverse.");
+
+	for(i = 0; i < FLAT_KEYS_NUMBER; i++) {
+		// duplicated random keys are deleted by their first copy
+		result = Hashmap_get(map1, keys[i]);
+		if(result == NULL) continue;
+
+		mu_assert(Hashmap_delete(map1, keys[i]) == result, "Wrong deleted value.");
+		mu_assert(Hashmap_get(map1, keys[i]) == NULL, "Should delete.");
+	}
+
+	mu_assert(map1->counter == 0, "Wrong number of nodes.");
+	mu_assert(map1->buckets_number < DEFAULT_NUMBER_OF_SLOTS, "Slots didn't shrink.");
+
+	Hashmap_destroy(map1);
+
+	for(i = 0; i < FLAT_KEYS_NUMBER; i++) {
+		bdestroy(keys[i]);
+	}
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DBENCH_MAX_KEYS=10000000 to get the 10^7 row
+#ifndef BENCH_MAX_KEYS
+#define BENCH_MAX_KEYS 1000000
+#endif
+
+static bstring *create_keys(int count)
+{
+	int i = 0;
+	bstring *keys = calloc(count, sizeof(bstring));
+	check_mem(keys);
+
+	for(i = 0; i < count; i++) {
+		keys[i] = bformat("key %d", i);
+	}
+
+	return keys;
+
+error:
+	return NULL;
+}
+
+static void destroy_keys(bstring *keys, int count)
+{
+	int i = 0;
+
+	for(i = 0; i < count; i++) {
+		bdestroy(keys[i]);
+	}
+
+	free(keys);
+}
+
+static char *run_engine_perfomance(Hashmap *map, bstring *keys, int count, const char *name)
+{
+	struct timespec start, end;
+	double set_diff, get_diff_ns;
+	int i = 0;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 0; i < count; i++) {
+		Hashmap_set(map, keys[i], keys[i]);
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	set_diff = (double)get_diff(start, end) / count;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 0; i < count; i++) {
+		mu_assert(Hashmap_get(map, keys[i]) == keys[i], "Wrong value.");
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	get_diff_ns = (double)get_diff(start, end) / count;
+
+	printf("\nHashmap %s with %d keys: set took %lf, get took %lf nanoseconds to run.\n",
+			name, count, set_diff, get_diff_ns);
+
+	return NULL;
+}
+
+char *test_engines_perfomance()
+{
+	char *message = NULL;
+	bstring *keys = NULL;
+	int count = 0;
+
+	for(count = 1000; count <= BENCH_MAX_KEYS; count *= 10) {
+		keys = create_keys(count);
+		mu_assert(keys != NULL, "Failed to allocate keys.");
+
+		// give the chained engine one bucket per key and no rehash
+		Hashmap *chained = Hashmap_create_advanced(NULL, NULL, count, count, 0);
+		message = run_engine_perfomance(chained, keys, count, "(chained)");
+		Hashmap_destroy(chained);
+		if(message) return message;
+
+		Hashmap *flat = Hashmap_create_flat(NULL, NULL, 0);
+		message = run_engine_perfomance(flat, keys, count, "(flat)");
+		Hashmap_destroy(flat);
+		if(message) return message;
+
+		destroy_keys(keys, count);
+	}
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DGROWTH_MAX_KEYS=10000000 to get the 10^7 row,
+// linear growth takes minutes there
+#ifndef GROWTH_MAX_KEYS
+#define GROWTH_MAX_KEYS 100000
+#endif
+
+static char *run_growth_perfomance(Hashmap *map, bstring *keys, int count, const char *name)
+{
+	struct timespec start, end;
+	int i = 0;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 0; i < count; i++) {
+		Hashmap_set(map, keys[i], keys[i]);
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+	mu_assert(map->counter == (uint32_t)count, "Wrong number of nodes.");
+
+	printf("\nHashmap %s with %d keys: %u rehashes, %u buckets, took %lf milliseconds to run.\n",
+			name, count, map->rehash_count, map->buckets_number, (double)get_diff(start, end) / 1000000);
+
+	return NULL;
+}
+
+char *test_growth_perfomance()
+{
+	char *message = NULL;
+	bstring *keys = NULL;
+	int count = 0;
+
+	for(count = 10000; count <= GROWTH_MAX_KEYS; count *= 10) {
+		keys = create_keys(count);
+		mu_assert(keys != NULL, "Failed to allocate keys.");
+
+		Hashmap *linear = Hashmap_create_advanced(NULL, NULL, 10000, 10000, 0);
+		message = run_growth_perfomance(linear, keys, count, "(linear growth)");
+		Hashmap_destroy(linear);
+		if(message) return message;
+
+		Hashmap *geometric = Hashmap_create(NULL, NULL);
+		message = run_growth_perfomance(geometric, keys, count, "(geometric growth)");
+		Hashmap_destroy(geometric);
+		if(message) return message;
+
+		destroy_keys(keys, count);
+	}
+
+	return NULL;
+}
+
+#define LATENCY_KEYS 100000
+
+static int latency_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static char *run_latency_perfomance(uint32_t rehash_step, const char *name)
+{
+	struct timespec start, end;
+	int i = 0;
+
+	bstring *keys = create_keys(LATENCY_KEYS);
+	uint64_t *latency = calloc(LATENCY_KEYS, sizeof(uint64_t));
+	mu_assert(keys != NULL && latency != NULL, "Failed to allocate keys.");
+
+	// linear growth by 1000 buckets after every 1000 keys
+	Hashmap *map1 = Hashmap_create_advanced(NULL, NULL, 1000, 1000, 0);
+	mu_assert(Hashmap_set_rehash_step(map1, rehash_step) == 0, "Failed to set rehash step.");
+
+	for(i = 0; i < LATENCY_KEYS; i++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		Hashmap_set(map1, keys[i], keys[i]);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		latency[i] = get_diff(start, end);
+	}
+
+	for(i = 0; i < LATENCY_KEYS; i++) {
+		mu_assert(Hashmap_get(map1, keys[i]) == keys[i], "Wrong value.");
+	}
+
+	qsort(latency, LATENCY_KEYS, sizeof(uint64_t), latency_cmp);
+
+	printf("\nHashmap set %s: p50 %lu, p99 %lu, p999 %lu, max %lu nanoseconds.\n", name,
+			(unsigned long)latency[LATENCY_KEYS / 2],
+			(unsigned long)latency[LATENCY_KEYS / 100 * 99],
+			(unsigned long)latency[LATENCY_KEYS / 1000 * 999],
+			(unsigned long)latency[LATENCY_KEYS - 1]);
+
+	Hashmap_destroy(map1);
+	destroy_keys(keys, LATENCY_KEYS);
+	free(latency);
+
+	return NULL;
+}
+
+char *test_rehash_latency_perfomance()
+{
+	char *message = run_latency_perfomance(0, "(full rehash)");
+	if(message) return message;
+
+	return run_latency_perfomance(1, "(incremental rehash)");
+}
+
+// build with OPTFLAGS=-DBATCH_KEYS=10000000 for a map far out of cache
+#ifndef BATCH_KEYS
+#define BATCH_KEYS 1000000
+#endif
+
+static char *run_batch_perfomance(Hashmap *map, bstring *keys, bstring *lookups, void **out, const char *name)
+{
+	struct timespec start, end;
+	int batches[] = {1, 8, 64, 512};
+	int found = 0;
+	int b = 0;
+	int i = 0;
+
+	mu_assert(Hashmap_set_many(map, (void **)keys, (void **)keys, BATCH_KEYS) == 0, "Failed to set keys.");
+
+	for(b = 0; b < 4; b++) {
+		found = 0;
+
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+		for(i = 0; i < BATCH_KEYS; i += batches[b]) {
+			found += Hashmap_get_many(map, (void **)&lookups[i],
+					BATCH_KEYS - i < batches[b] ? BATCH_KEYS - i : batches[b], &out[i]);
+		}
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+		mu_assert(found == BATCH_KEYS, "Wrong number of found keys.");
+
+		printf("\nHashmap_get_many %s of %d keys in batches of %d took %lf nanoseconds per key.\n",
+				name, BATCH_KEYS, batches[b], (double)get_diff(start, end) / BATCH_KEYS);
+	}
+
+	return NULL;
+}
+
+char *test_batch_perfomance()
+{
+	char *message = NULL;
+	bstring *keys = create_keys(BATCH_KEYS);
+	bstring *lookups = calloc(BATCH_KEYS, sizeof(bstring));
+	void **out = calloc(BATCH_KEYS, sizeof(void *));
+	int i = 0;
+
+	mu_assert(keys && lookups && out, "Failed to allocate keys.");
+
+	// random order, so every lookup misses the cache
+	for(i = 0; i < BATCH_KEYS; i++) {
+		lookups[i] = keys[rand() % BATCH_KEYS];
+	}
+
+	Hashmap *chained = Hashmap_create(NULL, NULL);
+	message = run_batch_perfomance(chained, keys, lookups, out, "(chained)");
+	Hashmap_destroy(chained);
+	if(message) return message;
+
+	Hashmap *flat = Hashmap_create_flat(NULL, NULL, 0);
+	message = run_batch_perfomance(flat, keys, lookups, out, "(flat)");
+	Hashmap_destroy(flat);
+	if(message) return message;
+
+	free(out);
+	free(lookups);
+	destroy_keys(keys, BATCH_KEYS);
+
+	return NULL;
+}
+
+char *test_seeded_hash()
+{
+	struct tagbstring key = bsStatic("same key");
+	Hashmap *map1 = Hashmap_create(NULL, NULL);
+	Hashmap *map2 = Hashmap_create_flat(NULL, NULL, 0);
+	Hashmap *unseeded = Hashmap_create(NULL, default_hash);
+
+	mu_assert(map1->keyed_hash == Hashmap_siphash, "Default hash should be keyed.");
+	mu_assert(map2->keyed_hash == Hashmap_siphash, "Default hash should be keyed.");
+	mu_assert(unseeded->keyed_hash == NULL && unseeded->hash == default_hash, "Given hash should be used.");
+	mu_assert(map1->seed[0] != map2->seed[0] || map1->seed[1] != map2->seed[1], "Maps should get their own seeds.");
+
+	mu_assert(Hashmap_set(map1, &key, &expect1) == 0, "Failed to set.");
+	mu_assert(Hashmap_set(map2, &key, &expect1) == 0, "Failed to set.");
+	mu_assert(Hashmap_get(map1, &key) == &expect1, "Wrong value.");
+	mu_assert(Hashmap_get(map2, &key) == &expect1, "Wrong value.");
+
+	Hashmap_destroy(map1);
+	Hashmap_destroy(map2);
+	Hashmap_destroy(unseeded);
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DPREHASHED_KEY_LEN=... for other key lengths
+#ifndef PREHASHED_KEY_LEN
+#define PREHASHED_KEY_LEN 256
+#endif
+
+#define PREHASHED_BENCH_KEYS 100000
+#define PREHASHED_BENCH_ROUNDS 10
+
+char *test_prehashed_perfomance()
+{
+	struct timespec start, end;
+	bstring *keys = calloc(PREHASHED_BENCH_KEYS, sizeof(bstring));
+	uint32_t *hashes = calloc(PREHASHED_BENCH_KEYS, sizeof(uint32_t));
+	double get_ns, prehashed_ns;
+	int round = 0;
+	int i = 0;
+
+	mu_assert(keys && hashes, "Failed to allocate keys.");
+
+	Hashmap *map1 = Hashmap_create(NULL, NULL);
+
+	for(i = 0; i < PREHASHED_BENCH_KEYS; i++) {
+		keys[i] = bformat("%0*d", PREHASHED_KEY_LEN, i);
+		hashes[i] = Hashmap_key_hash(map1, keys[i]);
+		Hashmap_set_prehashed(map1, keys[i], hashes[i], keys[i]);
+	}
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(round = 0; round < PREHASHED_BENCH_ROUNDS; round++) {
+		for(i = 0; i < PREHASHED_BENCH_KEYS; i++) {
+			mu_assert(Hashmap_get(map1, keys[i]) == keys[i], "Wrong value.");
+		}
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	get_ns = (double)get_diff(start, end) / PREHASHED_BENCH_ROUNDS / PREHASHED_BENCH_KEYS;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(round = 0; round < PREHASHED_BENCH_ROUNDS; round++) {
+		for(i = 0; i < PREHASHED_BENCH_KEYS; i++) {
+			mu_assert(Hashmap_get_prehashed(map1, keys[i], hashes[i]) == keys[i], "Wrong value.");
+		}
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	prehashed_ns = (double)get_diff(start, end) / PREHASHED_BENCH_ROUNDS / PREHASHED_BENCH_KEYS;
+
+	printf("\nHashmap_get of %d byte keys took %lf, Hashmap_get_prehashed took %lf nanoseconds.\n",
+			PREHASHED_KEY_LEN, get_ns, prehashed_ns);
+
+	Hashmap_destroy(map1);
+	free(hashes);
+	destroy_keys(keys, PREHASHED_BENCH_KEYS);
+
+	return NULL;
+}
+
+/*
+ * default_hash keeps a 32 bit state and mixes it only at the end, so
+ * two 4 letter blocks taking one state to the same next state collide
+ * with any suffix. ADVERSARIAL_STAGES such pairs in a row give
+ * 2^ADVERSARIAL_STAGES keys with the same hash (Joux multicollisions).
+ */
+#ifndef ADVERSARIAL_STAGES
+#define ADVERSARIAL_STAGES 12
+#endif
+
+#define ADVERSARIAL_BLOCK 4
+#define ADVERSARIAL_TRIES (1 << 18)
+#define ADVERSARIAL_ROUNDS 4
+
+typedef struct AdversarialBlock {
+	uint32_t state;
+	char letters[ADVERSARIAL_BLOCK];
+} AdversarialBlock;
+
+static inline uint32_t one_at_a_time_step(uint32_t hash, const char *letters)
+{
+	int i = 0;
+
+	for(i = 0; i < ADVERSARIAL_BLOCK; i++) {
+		hash += letters[i];
+		hash += (hash << 10);
+		hash ^= (hash >> 6);
+	}
+
+	return hash;
+}
+
+static int adversarial_block_cmp(const void *a, const void *b)
+{
+	uint32_t state_a = ((AdversarialBlock *)a)->state;
+	uint32_t state_b = ((AdversarialBlock *)b)->state;
+
+	return state_a < state_b ? -1 : state_a > state_b;
+}
+
+/*
+ * Birthday search for two blocks that take 'state' to the same state,
+ * put to 'next'. From some states no two blocks collide, then it gives
+ * up after ADVERSARIAL_ROUNDS and returns -1.
+ */
+static int find_block_collision(uint32_t state, AdversarialBlock *blocks, char pair[2][ADVERSARIAL_BLOCK], uint32_t *next)
+{
+	int round = 0;
+	int i = 0;
+	int j = 0;
+
+	for(round = 0; round < ADVERSARIAL_ROUNDS; round++) {
+		for(i = 0; i < ADVERSARIAL_TRIES; i++) {
+			for(j = 0; j < ADVERSARIAL_BLOCK; j++) {
+				blocks[i].letters[j] = 'a' + rand() % 26;
+			}
+			blocks[i].state = one_at_a_time_step(state, blocks[i].letters);
+		}
+
+		qsort(blocks, ADVERSARIAL_TRIES, sizeof(AdversarialBlock), adversarial_block_cmp);
+
+		for(i = 1; i < ADVERSARIAL_TRIES; i++) {
+			if(blocks[i].state == blocks[i - 1].state &&
+					memcmp(blocks[i].letters, blocks[i - 1].letters, ADVERSARIAL_BLOCK) != 0) {
+				memcpy(pair[0], blocks[i - 1].letters, ADVERSARIAL_BLOCK);
+				memcpy(pair[1], blocks[i].letters, ADVERSARIAL_BLOCK);
+				*next = blocks[i].state;
+				return 0;
+			}
+		}
+	}
+
+	return -1;
+}
+
+static bstring *create_adversarial_keys(int count)
+{
+	char pairs[ADVERSARIAL_STAGES][2][ADVERSARIAL_BLOCK];
+	char key[ADVERSARIAL_STAGES * ADVERSARIAL_BLOCK];
+	uint32_t states[ADVERSARIAL_STAGES + 1] = {0};
+	int stage = 0;
+	int i = 0;
+
+	AdversarialBlock *blocks = calloc(ADVERSARIAL_TRIES, sizeof(AdversarialBlock));
+	bstring *keys = calloc(count, sizeof(bstring));
+	check_mem(blocks && keys);
+
+	while(stage < ADVERSARIAL_STAGES) {
+		if(find_block_collision(states[stage], blocks, pairs[stage], &states[stage + 1]) == 0) {
+			stage++;
+		} else if(stage > 0) {
+			// a dead end, another pair one stage back gives another state
+			stage--;
+		}
+	}
+
+	// every bit of 'i' picks one block of a pair
+	for(i = 0; i < count; i++) {
+		for(stage = 0; stage < ADVERSARIAL_STAGES; stage++) {
+			memcpy(key + stage * ADVERSARIAL_BLOCK, pairs[stage][(i >> stage) & 1], ADVERSARIAL_BLOCK);
+		}
+		keys[i] = blk2bstr(key, sizeof(key));
+	}
+
+	free(blocks);
+
+	return keys;
+
+error:
+	free(blocks);
+	free(keys);
+
+	return NULL;
+}
+
+static bstring *create_random_keys(int count)
+{
+	char key[ADVERSARIAL_STAGES * ADVERSARIAL_BLOCK];
+	int i = 0;
+	int j = 0;
+
+	bstring *keys = calloc(count, sizeof(bstring));
+	check_mem(keys);
+
+	for(i = 0; i < count; i++) {
+		for(j = 0; j < (int)sizeof(key); j++) {
+			key[j] = 'a' + rand() % 26;
+		}
+		keys[i] = blk2bstr(key, sizeof(key));
+	}
+
+	return keys;
+
+error:
+	return NULL;
+}
+
+static char *run_adversarial_perfomance(Hashmap *map, bstring *keys, int count, const char *name)
+{
+	struct timespec start, end;
+	int i = 0;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 0; i < count; i++) {
+		Hashmap_set(map, keys[i], keys[i]);
+	}
+	for(i = 0; i < count; i++) {
+		mu_assert(Hashmap_get(map, keys[i]) == keys[i], "Wrong value.");
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+	mu_assert(map->counter == (uint32_t)count, "Wrong number of nodes.");
+
+	printf("\nHashmap %s with %d keys: %lf Mops/s.\n", name, count, 2.0 * count * 1000 / get_diff(start, end));
+
+	Hashmap_destroy(map);
+
+	return NULL;
+}
+
+char *test_adversarial_perfomance()
+{
+	char *message = NULL;
+	int count = 1 << ADVERSARIAL_STAGES;
+	bstring *adversarial = create_adversarial_keys(count);
+	bstring *random = create_random_keys(count);
+	uint32_t hash = 0;
+	int i = 0;
+
+	mu_assert(adversarial && random, "Failed to create keys.");
+
+	hash = default_hash(adversarial[0]);
+	for(i = 1; i < count; i++) {
+		mu_assert(default_hash(adversarial[i]) == hash, "Adversarial keys should collide.");
+	}
+
+	struct {
+		Hashmap *map;
+		bstring *keys;
+		const char *name;
+	} runs[] = {
+		{Hashmap_create(NULL, default_hash), random, "(chained, default_hash, random keys)"},
+		{Hashmap_create(NULL, default_hash), adversarial, "(chained, default_hash, adversarial keys)"},
+		{Hashmap_create(NULL, NULL), random, "(chained, seeded siphash, random keys)"},
+		{Hashmap_create(NULL, NULL), adversarial, "(chained, seeded siphash, adversarial keys)"},
+		{Hashmap_create_flat(NULL, default_hash, 0), random, "(flat, default_hash, random keys)"},
+		{Hashmap_create_flat(NULL, default_hash, 0), adversarial, "(flat, default_hash, adversarial keys)"},
+		{Hashmap_create_flat(NULL, NULL, 0), random, "(flat, seeded siphash, random keys)"},
+		{Hashmap_create_flat(NULL, NULL, 0), adversarial, "(flat, seeded siphash, adversarial keys)"}
+	};
+
+	for(i = 0; i < (int)(sizeof(runs) / sizeof(runs[0])); i++) {
+		message = run_adversarial_perfomance(runs[i].map, runs[i].keys, count, runs[i].name);
+		if(message) return message;
+	}
+
+	destroy_keys(adversarial, count);
+	destroy_keys(random, count);
+
+	return NULL;
+}
+
 char *all_tests()
 {
 	mu_suite_start();
@@ -294,10 +1413,32 @@ char *all_tests()
 	mu_run_test(test_delete);
 	mu_run_test(test_destroy);
 	
+	mu_run_test(test_create_flat);
+	mu_run_test(test_get_set);
+	mu_run_test(test_traverse);
+	mu_run_test(test_delete);
+	mu_run_test(test_destroy);
+
 	mu_run_test(test_rehash);
 
 	srand(time(NULL));
 	mu_run_test(filling_defect);
+	mu_run_test(test_incremental_rehash);
+	mu_run_test(test_geometric_growth);
+	mu_run_test(test_flat_fuzzing);
+	mu_run_test(test_get_allocations);
+	mu_run_test(test_get_set_many);
+	mu_run_test(test_iterator);
+	mu_run_test(test_stats);
+	mu_run_test(test_seeded_hash);
+	mu_run_test(test_prehashed);
+
+	mu_run_test(test_engines_perfomance);
+	mu_run_test(test_rehash_latency_perfomance);
+	mu_run_test(test_growth_perfomance);
+	mu_run_test(test_batch_perfomance);
+	mu_run_test(test_prehashed_perfomance);
+	mu_run_test(test_adversarial_perfomance);
 
 	return NULL;
 }
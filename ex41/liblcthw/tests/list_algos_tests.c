@@ -3,7 +3,6 @@
 #include <assert.h>
 #include <string.h>
 #include <time.h>
-#include <sys/resource.h>
 
 char *values[] = {"XXXX", "1234", "abcd", "xjvef", "NDSS", "I", "like", "kopro", "experiments"};
 #define NUM_VALUES 9
@@ -31,26 +30,6 @@ long get_diff(struct timespec start, struct timespec end)
 	return (unsigned long)(end.tv_sec - start.tv_sec) * BILLION + (unsigned long)(end.tv_nsec - start.tv_nsec);
 }
 
-void stack_increase()
-{
-	const rlim_t kStackSize = 256L * 1024L * 1024L;
-	struct rlimit rl;
-	int result;
-
-	result = getrlimit(RLIMIT_STACK, &rl);
-	if(result == 0) {
-		if(rl.rlim_cur < kStackSize) {	
-			rl.rlim_cur = kStackSize;
-
-			result = setrlimit(RLIMIT_STACK, &rl);
-
-            if(result != 0) {
-                fprintf(stderr, "setrlimit returned result = %d\n", result);
-			}
-		}
-	}
-}
-
 char *test_bubble_sort()
 {
 	List *words = create_words();
@@ -145,8 +124,8 @@ char *test_bubble_perfomance()
 
 	int i = 0;
 
-	List *bubble_words[ITER];
-	int rc[ITER];
+	static List *bubble_words[ITER];
+	static int rc[ITER];
 
 	// bubble sort bootstrap
 	for(i = 0; i < ITER; i++) {
@@ -184,7 +163,7 @@ char *test_merge_perfomance()
 	int i = 0;
 
 	List *merge_words = NULL;
-	List *merged_words[ITER];
+	static List *merged_words[ITER];
 
 	// merge sort bootstrap
 	merge_words = create_words();
@@ -220,8 +199,8 @@ char *test_insert_perfomance()
 
 	int i = 0;
 
-	List *insert_words[ITER];
-	List *insert_sorted_words[ITER];
+	static List *insert_words[ITER];
+	static List *insert_sorted_words[ITER];
 
 	// insert sort bootstrap
 	for(i = 0; i < ITER; i++) {
@@ -259,8 +238,8 @@ char *test_bottom_up_perfomance()
 
 	int i = 0;
 
-	List *bottom_up_words[ITER];
-	List *bottom_up_sorted_words[ITER];
+	static List *bottom_up_words[ITER];
+	static List *bottom_up_sorted_words[ITER];
 
 	// bottom up sort bootstrap
 	for(i = 0; i < ITER; i++) {
@@ -300,8 +279,6 @@ char *all_tests()
 	mu_run_test(test_insert_sort);
 	mu_run_test(test_bottom_up_sort);
 
-	stack_increase();
-
 	mu_run_test(test_bubble_perfomance);
 	mu_run_test(test_merge_perfomance);
 	mu_run_test(test_insert_perfomance);
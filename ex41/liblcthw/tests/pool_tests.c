@@ -0,0 +1,199 @@
+#include "minunit.h"
+#include <lcthw/pool.h>
+#include <lcthw/hashmap.h>
+#include <lcthw/bstree.h>
+#include <lcthw/list.h>
+#include <lcthw/bstrlib.h>
+#include <lcthw/tests_routines.h>
+
+static Pool *pool = NULL;
+
+#define ELEMENTS 100
+
+char *test_create()
+{
+	pool = Pool_create(20, 8);
+	mu_assert(pool != NULL, "Failed to create pool.");
+	mu_assert(pool->element_size == 32, "Element size should be aligned.");
+	mu_assert(Pool_count(pool) == 0, "Pool should be empty.");
+
+	return NULL;
+}
+
+char *test_alloc_free()
+{
+	void *elements[ELEMENTS] = {NULL};
+	int i = 0;
+
+	for(i = 0; i < ELEMENTS; i++) {
+		elements[i] = Pool_alloc(pool);
+		mu_assert(elements[i] != NULL, "Failed to alloc.");
+		mu_assert(*(uint64_t *)elements[i] == 0, "Element should be zeroed.");
+		memset(elements[i], 0xff, 20);
+	}
+
+	mu_assert(Pool_count(pool) == ELEMENTS, "Wrong count.");
+
+	// freed elements are reused before new ones are cut
+	void *last = elements[ELEMENTS - 1];
+	Pool_free(pool, last);
+	mu_assert(Pool_count(pool) == ELEMENTS - 1, "Wrong count after free.");
+	mu_assert(Pool_alloc(pool) == last, "Freed element should be reused.");
+
+	for(i = 0; i < ELEMENTS; i++) {
+		Pool_free(pool, elements[i]);
+	}
+
+	mu_assert(Pool_count(pool) == 0, "Pool should be empty.");
+
+	return NULL;
+}
+
+char *test_reset()
+{
+	int i = 0;
+
+	for(i = 0; i < ELEMENTS; i++) {
+		Pool_alloc(pool);
+	}
+
+	PoolSlab *slabs = pool->first;
+
+	Pool_reset(pool);
+	mu_assert(Pool_count(pool) == 0, "Pool should be empty after reset.");
+
+	// the slabs are kept and cut from the start again
+	void *again = Pool_alloc(pool);
+	mu_assert(pool->first == slabs, "Slabs should be kept.");
+	mu_assert(again == pool->cursor - pool->element_size, "Should cut from the first slab.");
+
+	return NULL;
+}
+
+char *test_destroy()
+{
+	Pool_destroy(pool);
+
+	return NULL;
+}
+
+struct tagbstring test1 = bsStatic("test data 1");
+struct tagbstring test2 = bsStatic("test data 2");
+struct tagbstring test3 = bsStatic("xest data 3");
+
+char *test_pooled_containers()
+{
+	Pool *nodes = Pool_create(sizeof(BSTreeNode), 0);
+	mu_assert(nodes != NULL, "Failed to create pool.");
+
+	// one pool is enough for all three node types
+	Hashmap *map = Hashmap_create_pooled(NULL, NULL, nodes);
+	BSTree *tree = BSTree_create_pooled(NULL, nodes);
+	List *list = List_create_pooled(nodes);
+	mu_assert(map && tree && list, "Failed to create pooled containers.");
+
+	Hashmap_set(map, &test1, &test1);
+	Hashmap_set(map, &test2, &test2);
+	BSTree_set(tree, &test1, &test1);
+	BSTree_set(tree, &test3, &test3);
+	List_push(list, &test1);
+	List_push(list, &test2);
+	List_unshift(list, &test3);
+	mu_assert(Pool_count(nodes) == 7, "Wrong number of pooled nodes.");
+
+	mu_assert(Hashmap_get(map, &test2) == &test2, "Wrong hashmap value.");
+	mu_assert(BSTree_get(tree, &test3) == &test3, "Wrong bstree value.");
+	mu_assert(List_first(list) == &test3, "Wrong list value.");
+
+	mu_assert(Hashmap_delete(map, &test1) == &test1, "Wrong deleted hashmap value.");
+	mu_assert(BSTree_delete(tree, &test1) == &test1, "Wrong deleted bstree value.");
+	mu_assert(List_pop(list) == &test2, "Wrong popped list value.");
+	mu_assert(Pool_count(nodes) == 4, "Nodes should go back to the pool.");
+
+	Hashmap_destroy(map);
+	BSTree_destroy(tree);
+	List_clear_destroy(list);
+	mu_assert(Pool_count(nodes) == 0, "Destroy should give all nodes back.");
+
+	Pool_destroy(nodes);
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DPOOL_KEYS=10000000 for bigger maps
+#ifndef POOL_KEYS
+#define POOL_KEYS 1000000
+#endif
+
+static char *run_build_teardown_perfomance(bstring *keys, Pool *nodes, const char *name)
+{
+	struct timespec start, end;
+	int i = 0;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+
+	Hashmap *map = nodes ? Hashmap_create_pooled(NULL, NULL, nodes) : Hashmap_create(NULL, NULL);
+	mu_assert(map != NULL, "Failed to create map.");
+
+	for(i = 0; i < POOL_KEYS; i++) {
+		Hashmap_set(map, keys[i], keys[i]);
+	}
+
+	Hashmap_destroy(map);
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+	printf("\nHashmap build and teardown %s with %d keys took %lf milliseconds to run.\n",
+			name, POOL_KEYS, (double)get_diff(start, end) / 1000000);
+
+	return NULL;
+}
+
+char *test_pool_perfomance()
+{
+	char *message = NULL;
+	int round = 0;
+	int i = 0;
+
+	bstring *keys = calloc(POOL_KEYS, sizeof(bstring));
+	mu_assert(keys != NULL, "Failed to allocate keys.");
+
+	for(i = 0; i < POOL_KEYS; i++) {
+		keys[i] = bformat("key %d", i);
+	}
+
+	// the first round also pays for growing the heap
+	for(round = 0; round < 2; round++) {
+		message = run_build_teardown_perfomance(keys, NULL, "(calloc)");
+		if(message) return message;
+
+		Pool *nodes = Pool_create(sizeof(HashmapNode), 0);
+		message = run_build_teardown_perfomance(keys, nodes, "(pool)");
+		Pool_destroy(nodes);
+		if(message) return message;
+	}
+
+	for(i = 0; i < POOL_KEYS; i++) {
+		bdestroy(keys[i]);
+	}
+	free(keys);
+
+	return NULL;
+}
+
+char *all_tests()
+{
+	mu_suite_start();
+
+	mu_run_test(test_create);
+	mu_run_test(test_alloc_free);
+	mu_run_test(test_reset);
+	mu_run_test(test_destroy);
+
+	mu_run_test(test_pooled_containers);
+	mu_run_test(test_pool_perfomance);
+
+	return NULL;
+}
+
+RUN_TESTS(all_tests);
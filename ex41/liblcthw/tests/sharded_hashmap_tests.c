@@ -0,0 +1,232 @@
+#include "minunit.h"
+#include <lcthw/sharded_hashmap.h>
+#include <lcthw/bstrlib.h>
+#include <lcthw/tests_routines.h>
+#include <pthread.h>
+
+static ShardedHashmap *map = NULL;
+static int traverse_called = 0;
+struct tagbstring test1 = bsStatic("test data 1");
+struct tagbstring test2 = bsStatic("test data 2");
+struct tagbstring test3 = bsStatic("xest data 3");
+struct tagbstring expect1 = bsStatic("THE VALUE 1");
+struct tagbstring expect2 = bsStatic("THE VALUE 2");
+struct tagbstring expect3 = bsStatic("THE VALUE 3");
+
+static int traverse_good_cb(HashmapNode *node)
+{
+	debug("KEY: %s", bdata((bstring)node->key));
+	traverse_called++;
+	return 0;
+}
+
+char *test_create()
+{
+	map = ShardedHashmap_create(NULL, NULL, 10);
+	mu_assert(map != NULL, "Failed to create map.");
+	mu_assert(map->shards_number == 16, "Shards number should be a power of two.");
+	mu_assert(map->shard_shift == 28, "Wrong shard shift.");
+	mu_assert(map->keyed_hash != NULL, "Should default to a seeded hash.");
+
+	return NULL;
+}
+
+char *test_destroy()
+{
+	ShardedHashmap_destroy(map);
+
+	return NULL;
+}
+
+char *test_get_set()
+{
+	int rc = ShardedHashmap_set(map, &test1, &expect1);
+	mu_assert(rc == 0, "Failed to set test1.");
+	mu_assert(ShardedHashmap_get(map, &test1) == &expect1, "Wrong value for test1.");
+
+	rc = ShardedHashmap_set(map, &test2, &expect2);
+	mu_assert(rc == 0, "Failed to set test2.");
+	mu_assert(ShardedHashmap_get(map, &test2) == &expect2, "Wrong value for test2.");
+
+	rc = ShardedHashmap_set(map, &test3, &expect3);
+	mu_assert(rc == 0, "Failed to set test3.");
+	mu_assert(ShardedHashmap_get(map, &test3) == &expect3, "Wrong value for test3.");
+
+	mu_assert(ShardedHashmap_count(map) == 3, "Wrong count.");
+
+	// the shard maps hash with the same seed, so plain gets find the keys too
+	uint32_t i = 0;
+	int found = 0;
+	for(i = 0; i < map->shards_number; i++) {
+		found += Hashmap_get(map->shards[i].map, &test1) == &expect1;
+	}
+	mu_assert(found == 1, "Shard map should find test1 by itself.");
+
+	return NULL;
+}
+
+char *test_traverse()
+{
+	int rc = ShardedHashmap_traverse(map, traverse_good_cb);
+	mu_assert(rc == 0, "Failed to traverse.");
+	mu_assert(traverse_called == 3, "Wrong count traverse.");
+
+	return NULL;
+}
+
+char *test_delete()
+{
+	mu_assert(ShardedHashmap_delete(map, &test1) == &expect1, "Should get test1.");
+	mu_assert(ShardedHashmap_get(map, &test1) == NULL, "Should delete.");
+
+	mu_assert(ShardedHashmap_delete(map, &test2) == &expect2, "Should get test2.");
+	mu_assert(ShardedHashmap_delete(map, &test3) == &expect3, "Should get test3.");
+
+	mu_assert(ShardedHashmap_count(map) == 0, "Wrong count.");
+
+	return NULL;
+}
+
+#define KEYS_NUMBER 100000
+
+// build with OPTFLAGS=-DOPERATIONS_NUMBER=... for longer runs
+#ifndef OPERATIONS_NUMBER
+#define OPERATIONS_NUMBER 400000
+#endif
+
+static bstring keys[KEYS_NUMBER] = {NULL};
+
+typedef struct Worker {
+	pthread_t thread;
+	unsigned int seed;
+	int operations;
+	int read_percent;
+	int failed;
+	ShardedHashmap *sharded;
+	Hashmap *global;
+	pthread_mutex_t *global_lock;
+} Worker;
+
+static void *worker_run(void *arg)
+{
+	Worker *worker = arg;
+	int i = 0;
+	int key = 0;
+
+	for(i = 0; i < worker->operations; i++) {
+		key = rand_r(&worker->seed) % KEYS_NUMBER;
+
+		// every key is already there and maps to itself, writes keep it so
+		if((int)(rand_r(&worker->seed) % 100) < worker->read_percent) {
+			if(worker->sharded) {
+				worker->failed |= ShardedHashmap_get(worker->sharded, keys[key]) != keys[key];
+			} else {
+				pthread_mutex_lock(worker->global_lock);
+				worker->failed |= Hashmap_get(worker->global, keys[key]) != keys[key];
+				pthread_mutex_unlock(worker->global_lock);
+			}
+		} else {
+			if(worker->sharded) {
+				ShardedHashmap_set(worker->sharded, keys[key], keys[key]);
+			} else {
+				pthread_mutex_lock(worker->global_lock);
+				Hashmap_set(worker->global, keys[key], keys[key]);
+				pthread_mutex_unlock(worker->global_lock);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static char *run_threads(ShardedHashmap *sharded, Hashmap *global, int threads, int read_percent, const char *name)
+{
+	struct timespec start, end;
+	pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+	Worker workers[64];
+	int i = 0;
+
+	for(i = 0; i < threads; i++) {
+		workers[i].seed = i + 1;
+		workers[i].operations = OPERATIONS_NUMBER / threads;
+		workers[i].read_percent = read_percent;
+		workers[i].failed = 0;
+		workers[i].sharded = sharded;
+		workers[i].global = global;
+		workers[i].global_lock = &global_lock;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for(i = 0; i < threads; i++) {
+		mu_assert(pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]) == 0, "Failed to start thread.");
+	}
+
+	for(i = 0; i < threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		mu_assert(!workers[i].failed, "Wrong value under concurrent access.");
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("%s\t%d\t%d%%\t%lf\n", name, threads, read_percent,
+			(double)(OPERATIONS_NUMBER / threads * threads) * 1000 / get_diff(start, end));
+
+	return NULL;
+}
+
+char *test_threads_perfomance()
+{
+	char *message = NULL;
+	int read_percents[] = {100, 90, 50};
+	int threads = 0;
+	int r = 0;
+	int i = 0;
+
+	ShardedHashmap *sharded = ShardedHashmap_create(NULL, NULL, 64);
+	Hashmap *global = Hashmap_create(NULL, NULL);
+
+	for(i = 0; i < KEYS_NUMBER; i++) {
+		keys[i] = bformat("key %d", i);
+		ShardedHashmap_set(sharded, keys[i], keys[i]);
+		Hashmap_set(global, keys[i], keys[i]);
+	}
+
+	printf("\nMap\tThreads\tReads\tMops/s\n");
+
+	for(r = 0; r < 3; r++) {
+		for(threads = 1; threads <= 64; threads *= 2) {
+			message = run_threads(NULL, global, threads, read_percents[r], "global");
+			if(message) return message;
+
+			message = run_threads(sharded, NULL, threads, read_percents[r], "sharded");
+			if(message) return message;
+		}
+	}
+
+	ShardedHashmap_destroy(sharded);
+	Hashmap_destroy(global);
+
+	for(i = 0; i < KEYS_NUMBER; i++) {
+		bdestroy(keys[i]);
+	}
+
+	return NULL;
+}
+
+char *all_tests()
+{
+	mu_suite_start();
+
+	mu_run_test(test_create);
+	mu_run_test(test_get_set);
+	mu_run_test(test_traverse);
+	mu_run_test(test_delete);
+	mu_run_test(test_destroy);
+
+	mu_run_test(test_threads_perfomance);
+
+	return NULL;
+}
+
+RUN_TESTS(all_tests);
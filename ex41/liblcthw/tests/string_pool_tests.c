@@ -0,0 +1,160 @@
+#include "minunit.h"
+#include <lcthw/string_pool.h>
+#include <lcthw/bstrlib.h>
+#include <lcthw/tests_routines.h>
+
+static StringPool *pool = NULL;
+struct tagbstring host1 = bsStatic("www.example.com");
+struct tagbstring host2 = bsStatic("mail.example.com");
+
+char *test_create()
+{
+	pool = StringPool_create(64);
+	mu_assert(pool != NULL, "Failed to create pool.");
+	mu_assert(StringPool_count(pool) == 0, "Pool should be empty.");
+
+	return NULL;
+}
+
+char *test_destroy()
+{
+	StringPool_destroy(pool);
+
+	return NULL;
+}
+
+char *test_intern()
+{
+	bstring copy = bstrcpy(&host1);
+
+	bstring first = StringPool_intern(pool, &host1);
+	mu_assert(first != NULL, "Failed to intern.");
+	mu_assert(first != &host1, "Interned string should be a copy.");
+	mu_assert(biseq(first, &host1) == 1, "Wrong content.");
+	mu_assert(first->data[first->slen] == '\0', "Interned string should end with a zero.");
+
+	mu_assert(StringPool_intern(pool, copy) == first, "Same content should be the same string.");
+	mu_assert(StringPool_intern_cstr(pool, "www.example.com") == first, "Same content should be the same string.");
+	mu_assert(StringPool_intern_blk(pool, "www.example.com!", 15) == first, "Same content should be the same string.");
+
+	bstring second = StringPool_intern(pool, &host2);
+	mu_assert(!StringPool_equals(first, second), "Different content should be different strings.");
+	mu_assert(StringPool_count(pool) == 2, "Wrong count.");
+
+	bstring empty = StringPool_intern_cstr(pool, "");
+	mu_assert(empty != NULL && blength(empty) == 0, "Failed to intern an empty string.");
+	mu_assert(StringPool_intern_blk(pool, "", 0) == empty, "Same content should be the same string.");
+
+	mu_assert(StringPool_find(pool, copy) == first, "Failed to find.");
+	bassigncstr(copy, "not interned");
+	mu_assert(StringPool_find(pool, copy) == NULL, "Find shouldn't add.");
+	mu_assert(StringPool_count(pool) == 3, "Wrong count.");
+
+	// canonical strings can't be changed behind the pool's back
+	mu_assert(bconcat(first, copy) == BSTR_ERR, "Interned string should be write protected.");
+	mu_assert(bdestroy(first) == BSTR_ERR, "Interned string shouldn't be destroyed.");
+	mu_assert(biseq(first, &host1) == 1, "Interned string was changed.");
+
+	bdestroy(copy);
+
+	return NULL;
+}
+
+char *test_long_strings()
+{
+	bstring long_string = bfromcstr("");
+	int i = 0;
+
+	// longer than a chunk, so it gets one of its own
+	for(i = 0; i < 100; i++) {
+		bformata(long_string, "%d,", i);
+	}
+
+	bstring interned = StringPool_intern(pool, long_string);
+	mu_assert(interned != NULL, "Failed to intern.");
+	mu_assert(biseq(interned, long_string) == 1, "Wrong content.");
+	mu_assert(StringPool_intern(pool, long_string) == interned, "Same content should be the same string.");
+
+	// the other strings weren't moved
+	mu_assert(biseq(StringPool_intern(pool, &host1), &host1) == 1, "Wrong content.");
+
+	bdestroy(long_string);
+
+	return NULL;
+}
+
+// build with OPTFLAGS=-DINTERN_STRINGS=... for longer runs
+#ifndef INTERN_STRINGS
+#define INTERN_STRINGS 1000000
+#endif
+
+#define INTERN_DISTINCT 1000
+
+char *test_intern_perfomance()
+{
+	struct timespec start, end;
+	bstring *copies = calloc(INTERN_STRINGS, sizeof(bstring));
+	bstring *interned = calloc(INTERN_STRINGS, sizeof(bstring));
+	char host[64];
+	size_t copies_bytes = 0;
+	double copy_ns, intern_ns;
+	int i = 0;
+
+	mu_assert(copies && interned, "Failed to allocate strings.");
+
+	StringPool *hosts = StringPool_create(0);
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 0; i < INTERN_STRINGS; i++) {
+		snprintf(host, sizeof(host), "host-%d.example.com", i % INTERN_DISTINCT);
+		copies[i] = bfromcstr(host);
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	copy_ns = (double)get_diff(start, end) / INTERN_STRINGS;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+	for(i = 0; i < INTERN_STRINGS; i++) {
+		snprintf(host, sizeof(host), "host-%d.example.com", i % INTERN_DISTINCT);
+		interned[i] = StringPool_intern_cstr(hosts, host);
+	}
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	intern_ns = (double)get_diff(start, end) / INTERN_STRINGS;
+
+	mu_assert(StringPool_count(hosts) == INTERN_DISTINCT, "Wrong count.");
+
+	for(i = 0; i < INTERN_STRINGS; i++) {
+		mu_assert(biseq(copies[i], interned[i]) == 1, "Wrong content.");
+		mu_assert(interned[i] == interned[i % INTERN_DISTINCT], "Same content should be the same string.");
+
+		// two allocations, the header and the data
+		copies_bytes += sizeof(struct tagbstring) + copies[i]->mlen;
+		bdestroy(copies[i]);
+	}
+
+	printf("\n%d strings, %d distinct: bfromcstr took %lf and %zu bytes, "
+			"StringPool_intern took %lf nanoseconds and %zu bytes.\n",
+			INTERN_STRINGS, INTERN_DISTINCT, copy_ns, copies_bytes, intern_ns,
+			hosts->bytes + hosts->map->buckets_number * sizeof(HashmapNode));
+
+	StringPool_destroy(hosts);
+	free(interned);
+	free(copies);
+
+	return NULL;
+}
+
+char *all_tests()
+{
+	mu_suite_start();
+
+	mu_run_test(test_create);
+	mu_run_test(test_intern);
+	mu_run_test(test_long_strings);
+	mu_run_test(test_destroy);
+
+	mu_run_test(test_intern_perfomance);
+
+	return NULL;
+}
+
+RUN_TESTS(all_tests);